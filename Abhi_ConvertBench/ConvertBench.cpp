@@ -0,0 +1,559 @@
+/**
+ *	@example ConvertBench.cpp
+ *
+ *	@brief ConvertBench.cpp measures what pixel format conversion costs and
+ *	how good the result is, so the algorithm passed to Convert() can be chosen
+ *	on data instead of habit. No camera is needed; frames come from
+ *	SyntheticCamera (see Abhi_common/SyntheticCamera.h).
+ *
+ *	The sweep covers source format x destination format x algorithm x
+ *	resolution x thread count. Three kernels are measured:
+ *	- Spinnaker Image::Convert() with each color processing algorithm. One call
+ *	  converts one frame, so threads convert different frames side by side.
+ *	- OpenCV cvtColor(), which splits a frame over its own threads.
+ *	- The in-house bilinear demosaic (Abhi_common/BayerDemosaic.h), split into
+ *	  stripes on a StripeWorkerPool.
+ *
+ *	For every case the tool prints nanoseconds per pixel (wall time divided by
+ *	all pixels converted, so lower is better at every thread count) and PSNR
+ *	against the noise-free scene the synthetic frame was made from. A 4-pixel
+ *	border and the first row, which carries the frame stamp, are left out of
+ *	the PSNR.
+ *
+ *	Usage: ConvertBench [-o results.json] [-n frames] [-t max-threads]
+ *		[-r width x height, e.g. -r 1280x1024]
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/opencv.hpp>
+#include "SyntheticCamera.h"
+#include "BayerDemosaic.h"
+#include "StripeWorkerPool.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+using namespace cv;
+
+// Frames converted per case and thread count
+const unsigned int k_defaultNumFrames = 20;
+
+// Distinct source frames the threads cycle through
+const unsigned int k_numSourceFrames = 4;
+
+// Pixels left out at each edge when computing PSNR
+const int k_psnrBorder = 4;
+
+// PSNR reported for identical images
+const double k_psnrIdentical = 99.0;
+
+enum convertKernel
+{
+	KERNEL_SPINNAKER,
+	KERNEL_OPENCV,
+	KERNEL_BILINEAR
+};
+
+struct ConvertCase
+{
+	unsigned int width;
+	unsigned int height;
+	syntheticFormat sourceFormat;
+	PixelFormatEnums destinationFormat;
+	convertKernel kernel;
+	ColorProcessingAlgorithm algorithm;
+};
+
+struct ConvertResult
+{
+	ConvertCase convertCase;
+	unsigned int numThreads;
+	double nsPerPixel;
+	double psnr;
+};
+
+// Source frames of one resolution and format, with their references
+struct SourceFrames
+{
+	unsigned int width;
+	unsigned int height;
+	syntheticFormat format;
+	vector<vector<uint8_t> > frames;
+	vector<vector<uint8_t> > referencesColour;
+	vector<vector<uint8_t> > referencesMono;
+};
+
+const char* GetKernelName(convertKernel kernel)
+{
+	switch (kernel)
+	{
+	case KERNEL_SPINNAKER:
+		return "Spinnaker";
+	case KERNEL_OPENCV:
+		return "OpenCV";
+	default:
+		return "Bilinear";
+	}
+}
+
+const char* GetAlgorithmName(ColorProcessingAlgorithm algorithm)
+{
+	switch (algorithm)
+	{
+	case NEAREST_NEIGHBOR:
+		return "NEAREST_NEIGHBOR";
+	case EDGE_SENSING:
+		return "EDGE_SENSING";
+	case HQ_LINEAR:
+		return "HQ_LINEAR";
+	case DIRECTIONAL_FILTER:
+		return "DIRECTIONAL_FILTER";
+	case RIGOROUS:
+		return "RIGOROUS";
+	default:
+		return "DEFAULT";
+	}
+}
+
+const char* GetFormatName(PixelFormatEnums format)
+{
+	switch (format)
+	{
+	case PixelFormat_Mono8:
+		return "Mono8";
+	case PixelFormat_RGB8:
+		return "RGB8";
+	default:
+		return "BGR8";
+	}
+}
+
+// This function builds the sweep for one resolution. Spinnaker runs every
+// algorithm on Bayer input; Mono8 input has no algorithm to choose.
+void AddCases(unsigned int width, unsigned int height, vector<ConvertCase> & cases)
+{
+	const ColorProcessingAlgorithm algorithms[] = { NEAREST_NEIGHBOR, EDGE_SENSING, HQ_LINEAR, DIRECTIONAL_FILTER, RIGOROUS };
+	const PixelFormatEnums bayerDestinations[] = { PixelFormat_BGR8, PixelFormat_RGB8, PixelFormat_Mono8 };
+
+	ConvertCase convertCase = { width, height, SYNTHETIC_MONO8, PixelFormat_BGR8, KERNEL_SPINNAKER, DEFAULT };
+
+	// Mono8 source
+	cases.push_back(convertCase);
+	convertCase.kernel = KERNEL_OPENCV;
+	cases.push_back(convertCase);
+
+	// BayerRG8 source
+	convertCase.sourceFormat = SYNTHETIC_BAYER_RG8;
+	convertCase.kernel = KERNEL_SPINNAKER;
+
+	for (unsigned int d = 0; d < 3; d++)
+	{
+		convertCase.destinationFormat = bayerDestinations[d];
+
+		for (unsigned int a = 0; a < 5; a++)
+		{
+			convertCase.algorithm = algorithms[a];
+			cases.push_back(convertCase);
+		}
+	}
+
+	convertCase.algorithm = DEFAULT;
+	convertCase.kernel = KERNEL_OPENCV;
+	convertCase.destinationFormat = PixelFormat_BGR8;
+	cases.push_back(convertCase);
+	convertCase.destinationFormat = PixelFormat_Mono8;
+	cases.push_back(convertCase);
+
+	convertCase.kernel = KERNEL_BILINEAR;
+	convertCase.destinationFormat = PixelFormat_BGR8;
+	cases.push_back(convertCase);
+}
+
+// This function renders the source frames of one resolution and format and
+// their noise-free references.
+void PrepareSourceFrames(unsigned int width, unsigned int height, syntheticFormat format, SourceFrames & source)
+{
+	SyntheticCamera camera(width, height, format);
+
+	source.width = width;
+	source.height = height;
+	source.format = format;
+	source.frames.assign(k_numSourceFrames, vector<uint8_t>());
+	source.referencesColour.assign(k_numSourceFrames, vector<uint8_t>(static_cast<size_t>(width) * height * 3));
+	source.referencesMono.assign(k_numSourceFrames, vector<uint8_t>(static_cast<size_t>(width) * height));
+
+	for (unsigned int i = 0; i < k_numSourceFrames; i++)
+	{
+		uint64_t frameId = camera.GetFrameId();
+		const uint8_t* data = camera.NextFrame();
+
+		source.frames[i].assign(data, data + camera.GetImageSize());
+		camera.RenderReference(frameId, true, &source.referencesColour[i][0]);
+		camera.RenderReference(frameId, false, &source.referencesMono[i][0]);
+	}
+}
+
+// This function converts one frame with the given kernel. The output is
+// packed (stride = width * channels) in destination.
+void ConvertFrame(const ConvertCase & convertCase, const uint8_t* data, StripeWorkerPool & pool, vector<uint8_t> & destination)
+{
+	const int width = static_cast<int>(convertCase.width);
+	const int height = static_cast<int>(convertCase.height);
+	const int channels = convertCase.destinationFormat == PixelFormat_Mono8 ? 1 : 3;
+
+	destination.resize(static_cast<size_t>(width) * height * channels);
+
+	if (convertCase.kernel == KERNEL_SPINNAKER)
+	{
+		PixelFormatEnums sourceFormat = convertCase.sourceFormat == SYNTHETIC_MONO8 ? PixelFormat_Mono8 : PixelFormat_BayerRG8;
+
+		ImagePtr rawImage = Image::Create(width, height, 0, 0, sourceFormat, const_cast<uint8_t*>(data));
+		ImagePtr convertedImage = rawImage->Convert(convertCase.destinationFormat, convertCase.algorithm);
+
+		const size_t rowBytes = convertedImage->GetImageSize() / convertedImage->GetHeight();
+		const uint8_t* converted = static_cast<const uint8_t*>(convertedImage->GetData());
+
+		for (int y = 0; y < height; y++)
+		{
+			memcpy(&destination[static_cast<size_t>(y) * width * channels], converted + y * rowBytes, width * channels);
+		}
+	}
+	else if (convertCase.kernel == KERNEL_OPENCV)
+	{
+		// OpenCV names Bayer patterns after the second row, so RGGB is "BG"
+		Mat image = cv::Mat(height, width, CV_8UC1, const_cast<uint8_t*>(data), width);
+		Mat converted = cv::Mat(height, width, channels == 1 ? CV_8UC1 : CV_8UC3, &destination[0], width * channels);
+
+		if (convertCase.sourceFormat == SYNTHETIC_MONO8)
+		{
+			cv::cvtColor(image, converted, COLOR_GRAY2BGR);
+		}
+		else
+		{
+			cv::cvtColor(image, converted, channels == 1 ? COLOR_BayerBG2GRAY : COLOR_BayerBG2BGR);
+		}
+	}
+	else
+	{
+		const unsigned int numStripes = 2 * pool.GetNumThreads();
+		uint8_t* output = &destination[0];
+
+		pool.Run(numStripes, [&](unsigned int stripe)
+		{
+			const int rowBegin = height * stripe / numStripes;
+			const int rowEnd = height * (stripe + 1) / numStripes;
+
+			DemosaicBilinearRGGB(data, width, output, width * 3, width, height, rowBegin, rowEnd);
+		});
+	}
+}
+
+// This function returns the PSNR of a converted frame against its reference.
+// A colour output compared with a mono reference is compared channel by
+// channel.
+double ComputePsnr(const ConvertCase & convertCase, const vector<uint8_t> & converted, const SourceFrames & source, unsigned int frameIndex)
+{
+	const int width = static_cast<int>(convertCase.width);
+	const int height = static_cast<int>(convertCase.height);
+	const int channels = convertCase.destinationFormat == PixelFormat_Mono8 ? 1 : 3;
+	const bool colourReference = channels == 3 && convertCase.sourceFormat == SYNTHETIC_BAYER_RG8;
+	const bool swapRedBlue = convertCase.destinationFormat == PixelFormat_RGB8;
+
+	const vector<uint8_t> & reference = colourReference ? source.referencesColour[frameIndex] : source.referencesMono[frameIndex];
+
+	double squaredError = 0.0;
+	double numSamples = 0.0;
+
+	for (int y = max(k_psnrBorder, 1); y < height - k_psnrBorder; y++)
+	{
+		for (int x = k_psnrBorder; x < width - k_psnrBorder; x++)
+		{
+			const size_t pixel = static_cast<size_t>(y) * width + x;
+
+			for (int c = 0; c < channels; c++)
+			{
+				int referenceValue;
+				if (colourReference)
+				{
+					referenceValue = reference[pixel * 3 + (swapRedBlue ? 2 - c : c)];
+				}
+				else
+				{
+					referenceValue = reference[pixel];
+				}
+
+				const double error = static_cast<double>(converted[pixel * channels + c]) - referenceValue;
+				squaredError += error * error;
+				numSamples += 1.0;
+			}
+		}
+	}
+
+	if (numSamples == 0.0 || squaredError == 0.0)
+	{
+		return k_psnrIdentical;
+	}
+
+	return 10.0 * log10(255.0 * 255.0 / (squaredError / numSamples));
+}
+
+// This function is the body of one thread converting whole frames; it is used
+// for the kernels that convert a frame on a single thread.
+void ConvertFrames(const ConvertCase & convertCase, const SourceFrames & source, unsigned int firstFrame,
+	unsigned int numFrames, StripeWorkerPool & pool, int & result)
+{
+	vector<uint8_t> destination;
+
+	try
+	{
+		for (unsigned int i = 0; i < numFrames; i++)
+		{
+			ConvertFrame(convertCase, &source.frames[(firstFrame + i) % k_numSourceFrames][0], pool, destination);
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+}
+
+// This function times one case at one thread count and returns ns per pixel.
+int MeasureCase(const ConvertCase & convertCase, const SourceFrames & source, unsigned int numThreads,
+	unsigned int numFrames, double & nsPerPixel)
+{
+	int result = 0;
+
+	StripeWorkerPool pool(convertCase.kernel == KERNEL_BILINEAR ? numThreads : 1);
+	cv::setNumThreads(convertCase.kernel == KERNEL_OPENCV ? static_cast<int>(numThreads) : 1);
+
+	// Spinnaker converts a frame on one thread, so each thread gets frames
+	// of its own; the other kernels split every frame over the threads
+	const unsigned int numFrameThreads = convertCase.kernel == KERNEL_SPINNAKER ? numThreads : 1;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	if (numFrameThreads == 1)
+	{
+		ConvertFrames(convertCase, source, 0, numFrames, pool, result);
+	}
+	else
+	{
+		vector<thread> threads;
+		vector<int> threadResults(numFrameThreads, 0);
+		vector<StripeWorkerPool*> pools;
+
+		for (unsigned int i = 0; i < numFrameThreads; i++)
+		{
+			pools.push_back(new StripeWorkerPool(1));
+			threads.push_back(thread(ConvertFrames, cref(convertCase), cref(source), i, numFrames,
+				ref(*pools[i]), ref(threadResults[i])));
+		}
+
+		for (unsigned int i = 0; i < numFrameThreads; i++)
+		{
+			threads[i].join();
+			result = result | threadResults[i];
+			delete pools[i];
+		}
+	}
+
+	chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+
+	const double numPixels = static_cast<double>(numFrameThreads) * numFrames * convertCase.width * convertCase.height;
+	nsPerPixel = elapsed.count() / numPixels;
+
+	return result;
+}
+
+// This function writes the results as JSON, one case per line.
+void WriteResults(ostream & out, const vector<ConvertResult> & results, unsigned int numFrames)
+{
+	out << "{" << endl;
+	out << "  \"benchmark\": \"ConvertBench\"," << endl;
+	out << "  \"frames\": " << numFrames << "," << endl;
+	out << "  \"hardware_threads\": " << thread::hardware_concurrency() << "," << endl;
+	out << "  \"cases\": [" << endl;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const ConvertResult & r = results[i];
+
+		out << "    {\"width\": " << r.convertCase.width
+			<< ", \"height\": " << r.convertCase.height
+			<< ", \"source\": \"" << (r.convertCase.sourceFormat == SYNTHETIC_MONO8 ? "Mono8" : "BayerRG8") << "\""
+			<< ", \"destination\": \"" << GetFormatName(r.convertCase.destinationFormat) << "\""
+			<< ", \"kernel\": \"" << GetKernelName(r.convertCase.kernel) << "\""
+			<< ", \"algorithm\": \"" << GetAlgorithmName(r.convertCase.algorithm) << "\""
+			<< ", \"threads\": " << r.numThreads
+			<< ", \"ns_per_pixel\": " << r.nsPerPixel
+			<< ", \"psnr_db\": " << r.psnr
+			<< "}" << (i + 1 < results.size() ? "," : "") << endl;
+	}
+
+	out << "  ]" << endl;
+	out << "}" << endl;
+}
+
+// Example entry point
+int main(int argc, char** argv)
+{
+	int result = 0;
+
+	string outputPath;
+	unsigned int numFrames = k_defaultNumFrames;
+	unsigned int maxThreads = thread::hardware_concurrency() > 0 ? thread::hardware_concurrency() : 1;
+	unsigned int onlyWidth = 0;
+	unsigned int onlyHeight = 0;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-o") == 0)
+		{
+			outputPath = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "-n") == 0)
+		{
+			numFrames = static_cast<unsigned int>(atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-t") == 0)
+		{
+			maxThreads = static_cast<unsigned int>(atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-r") == 0)
+		{
+			if (sscanf(argv[i + 1], "%ux%u", &onlyWidth, &onlyHeight) != 2)
+			{
+				cout << "Unable to parse resolution " << argv[i + 1] << ". Aborting..." << endl << endl;
+				return -1;
+			}
+		}
+		else
+		{
+			cout << "Unknown option " << argv[i] << ". Aborting..." << endl << endl;
+			return -1;
+		}
+	}
+
+	if (numFrames == 0 || maxThreads == 0)
+	{
+		cout << "Frame and thread counts must be positive. Aborting..." << endl << endl;
+		return -1;
+	}
+
+	// Resolutions of the cameras we use, plus VGA
+	const unsigned int resolutions[][2] = { { 640, 480 }, { 1280, 1024 }, { 2048, 1536 } };
+
+	vector<ConvertCase> cases;
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		if (onlyWidth == 0 || (resolutions[i][0] == onlyWidth && resolutions[i][1] == onlyHeight))
+		{
+			AddCases(resolutions[i][0], resolutions[i][1], cases);
+		}
+	}
+
+	if (onlyWidth != 0 && cases.empty())
+	{
+		AddCases(onlyWidth, onlyHeight, cases);
+	}
+
+	// 1, 2, 4, ... up to the maximum
+	vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	cout << endl << "*** CONVERSION BENCHMARK ***" << endl << endl;
+
+	vector<ConvertResult> results;
+	SourceFrames source;
+	source.width = 0;
+	source.height = 0;
+	source.format = SYNTHETIC_MONO8;
+
+	for (size_t c = 0; c < cases.size(); c++)
+	{
+		const ConvertCase & convertCase = cases[c];
+
+		if (source.width != convertCase.width || source.height != convertCase.height || source.format != convertCase.sourceFormat)
+		{
+			PrepareSourceFrames(convertCase.width, convertCase.height, convertCase.sourceFormat, source);
+		}
+
+		// Quality does not depend on the thread count; measure it once
+		double psnr = 0.0;
+		try
+		{
+			StripeWorkerPool pool(1);
+			vector<uint8_t> converted;
+
+			ConvertFrame(convertCase, &source.frames[0][0], pool, converted);
+			psnr = ComputePsnr(convertCase, converted, source, 0);
+		}
+		catch (Spinnaker::Exception &e)
+		{
+			cout << "Error: " << e.what() << endl;
+			result = -1;
+			continue;
+		}
+
+		for (size_t t = 0; t < threadCounts.size(); t++)
+		{
+			ConvertResult convertResult;
+			convertResult.convertCase = convertCase;
+			convertResult.numThreads = threadCounts[t];
+			convertResult.psnr = psnr;
+
+			result = result | MeasureCase(convertCase, source, threadCounts[t], numFrames, convertResult.nsPerPixel);
+
+			cout << convertCase.width << "x" << convertCase.height << " "
+				<< (convertCase.sourceFormat == SYNTHETIC_MONO8 ? "Mono8" : "BayerRG8") << " -> "
+				<< GetFormatName(convertCase.destinationFormat) << " "
+				<< GetKernelName(convertCase.kernel) << " " << GetAlgorithmName(convertCase.algorithm)
+				<< ", " << threadCounts[t] << " threads: " << convertResult.nsPerPixel << " ns/pixel, "
+				<< psnr << " dB" << endl;
+
+			results.push_back(convertResult);
+		}
+	}
+
+	if (outputPath.empty())
+	{
+		cout << endl;
+		WriteResults(cout, results, numFrames);
+	}
+	else
+	{
+		ofstream out(outputPath.c_str());
+		if (!out.is_open())
+		{
+			cout << "Unable to write results to " << outputPath << ". Aborting..." << endl << endl;
+			return -1;
+		}
+
+		WriteResults(out, results, numFrames);
+
+		cout << endl << "Results written to " << outputPath << endl;
+	}
+
+	return result;
+}
@@ -0,0 +1,449 @@
+/**
+ *	@example FrameCatalog.cpp
+ *
+ *	@brief FrameCatalog.cpp records frames from all cameras the way
+ *	MultiCamStream does (one Cam-<serial>-<n>.jpg per frame) and keeps a
+ *	frame catalog per camera next to them (see Abhi_common/FrameCatalog.h).
+ *	The same program looks frames up by time in a recording, and can build
+ *	catalogs for recordings made before catalogs existed.
+ *
+ *	Usage:
+ *		FrameCatalog [-r directory]
+ *			record k_numImages frames per camera into directory
+ *		FrameCatalog -q directory seconds [-w window-seconds]
+ *			print the frame of every camera nearest to the given time
+ *			(seconds since the epoch) and all frames within the window
+ *		FrameCatalog -i directory
+ *			build catalogs for existing Cam-<serial>-<n>.jpg files, using
+ *			the file modification time as host timestamp
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/opencv.hpp>
+#include "FrameCatalog.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+using namespace cv;
+
+// Frames recorded per camera
+const unsigned int k_numImages = 1000;
+
+// Default recording directory
+const char* k_defaultDirectory = "recording";
+
+// This helper returns the wall clock in ns since the epoch.
+uint64_t GetHostTimestampNs()
+{
+	return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+		chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// This helper returns the file name of a frame, as MultiCamStream names it.
+string GetFrameFileName(const string & serial, uint64_t fileNumber)
+{
+	ostringstream filename;
+	filename << "Cam-" << serial << "-" << fileNumber << ".jpg";
+	return filename.str();
+}
+
+// This function records frames from all cameras and appends each saved frame
+// to the catalog of its camera.
+int RecordImages(CameraList camList, const string & directory)
+{
+	int result = 0;
+	CameraPtr pCam = NULL;
+
+	cout << endl << "*** RECORDING WITH FRAME CATALOG ***" << endl << endl;
+
+	try
+	{
+		vector<string> serialNumbers(camList.GetSize());
+		vector<FrameCatalogWriter*> catalogs;
+
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			CEnumerationPtr ptrAcquisitionMode = pCam->GetNodeMap().GetNode("AcquisitionMode");
+			if (!IsAvailable(ptrAcquisitionMode) || !IsWritable(ptrAcquisitionMode))
+			{
+				cout << "Unable to set acquisition mode to continuous (node retrieval; camera " << i << "). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			CEnumEntryPtr ptrAcquisitionModeContinuous = ptrAcquisitionMode->GetEntryByName("Continuous");
+			if (!IsAvailable(ptrAcquisitionModeContinuous) || !IsReadable(ptrAcquisitionModeContinuous))
+			{
+				cout << "Unable to set acquisition mode to continuous (entry 'continuous' retrieval " << i << "). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			ptrAcquisitionMode->SetIntValue(ptrAcquisitionModeContinuous->GetValue());
+
+			// The serial number names both the frames and the catalog
+			ostringstream serial;
+			serial << i;
+
+			CStringPtr ptrStringSerial = pCam->GetTLDeviceNodeMap().GetNode("DeviceSerialNumber");
+			if (IsAvailable(ptrStringSerial) && IsReadable(ptrStringSerial))
+			{
+				serial.str(ptrStringSerial->GetValue().c_str());
+			}
+			serialNumbers[i] = serial.str();
+
+			// Appending to an existing catalog keeps earlier recordings
+			// findable; frame numbers continue after them
+			catalogs.push_back(new FrameCatalogWriter());
+			if (catalogs[i]->Open(GetFrameCatalogPath(directory, serialNumbers[i]), serialNumbers[i]) != 0)
+			{
+				cout << "Unable to open catalog of camera " << serialNumbers[i] << ". Aborting..." << endl << endl;
+				result = -1;
+			}
+		}
+
+		vector<uint64_t> nextFileNumbers(camList.GetSize(), 0);
+		for (unsigned int i = 0; i < camList.GetSize() && result == 0; i++)
+		{
+			FrameCatalogReader reader;
+			if (reader.Open(GetFrameCatalogPath(directory, serialNumbers[i])) == 0 && reader.GetNumRecords() > 0)
+			{
+				nextFileNumbers[i] = reader.GetRecord(reader.GetNumRecords() - 1).fileNumber + 1;
+			}
+		}
+
+		for (unsigned int i = 0; i < camList.GetSize() && result == 0; i++)
+		{
+			camList.GetByIndex(i)->BeginAcquisition();
+
+			cout << "Camera " << serialNumbers[i] << " started acquiring images..." << endl;
+		}
+
+		for (unsigned int imageCnt = 0; imageCnt < k_numImages && result == 0; imageCnt++)
+		{
+			for (unsigned int i = 0; i < camList.GetSize(); i++)
+			{
+				try
+				{
+					pCam = camList.GetByIndex(i);
+
+					ImagePtr pResultImage = pCam->GetNextImage();
+
+					// Take the host time as close to the grab as possible
+					FrameCatalogRecord record;
+					record.hostTimestampNs = GetHostTimestampNs();
+
+					if (pResultImage->IsIncomplete())
+					{
+						cout << "Image incomplete with image status " << pResultImage->GetImageStatus() << "..." << endl << endl;
+					}
+					else
+					{
+						ImagePtr convertedImage = pResultImage->Convert(PixelFormat_Mono8, HQ_LINEAR);
+
+						unsigned int rowBytes = (int)convertedImage->GetImageSize() / convertedImage->GetHeight();
+
+						Mat image = cv::Mat(convertedImage->GetHeight(), convertedImage->GetWidth(), CV_8UC1,
+							convertedImage->GetData(), rowBytes);
+
+						record.cameraTimestampNs = pResultImage->GetTimeStamp();
+						record.frameId = pResultImage->GetFrameID();
+						record.fileNumber = nextFileNumbers[i]++;
+						record.offset = 0;
+
+						if (cv::imwrite(directory + "/" + GetFrameFileName(serialNumbers[i], record.fileNumber), image))
+						{
+							catalogs[i]->Append(record);
+						}
+						else
+						{
+							cout << "Unable to save frame " << record.fileNumber << " of camera " << serialNumbers[i] << endl;
+						}
+					}
+
+					pResultImage->Release();
+				}
+				catch (Spinnaker::Exception &e)
+				{
+					cout << "Error: " << e.what() << endl;
+					result = -1;
+				}
+			}
+		}
+
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+			if (pCam->IsStreaming())
+			{
+				pCam->EndAcquisition();
+			}
+
+			delete catalogs[i];
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function prints the frames of all cameras around a point in time.
+int QueryCatalogs(const string & directory, double seconds, double windowSeconds)
+{
+	FrameCatalogSet catalogs;
+
+	if (catalogs.Open(directory) <= 0)
+	{
+		cout << "No frame catalogs found in " << directory << ". Aborting..." << endl << endl;
+		return -1;
+	}
+
+	const uint64_t timeNs = static_cast<uint64_t>(seconds * 1e9);
+	const uint64_t windowNs = static_cast<uint64_t>(windowSeconds * 1e9);
+
+	vector<FrameCatalogRecord> nearest;
+	vector<bool> found;
+	catalogs.FindNearest(timeNs, nearest, found);
+
+	cout << endl << "*** NEAREST FRAMES ***" << endl << endl;
+
+	for (size_t i = 0; i < catalogs.GetNumCameras(); i++)
+	{
+		const string serial = catalogs.GetCamera(i).GetSerial();
+
+		if (!found[i])
+		{
+			cout << "Camera " << serial << ": no frames" << endl;
+			continue;
+		}
+
+		double offsetMs = (static_cast<double>(nearest[i].hostTimestampNs) - static_cast<double>(timeNs)) / 1e6;
+
+		cout << "Camera " << serial << ": " << GetFrameFileName(serial, nearest[i].fileNumber)
+			<< " (FrameID " << nearest[i].frameId << ", " << offsetMs << " ms)" << endl;
+	}
+
+	if (windowNs > 0)
+	{
+		vector<vector<FrameCatalogRecord> > ranges;
+		catalogs.FindRange(timeNs > windowNs ? timeNs - windowNs : 0, timeNs + windowNs + 1, ranges);
+
+		cout << endl << "*** FRAMES WITHIN " << windowSeconds << " s ***" << endl << endl;
+
+		for (size_t i = 0; i < ranges.size(); i++)
+		{
+			const string serial = catalogs.GetCamera(i).GetSerial();
+
+			cout << "Camera " << serial << ": " << ranges[i].size() << " frames" << endl;
+
+			for (size_t j = 0; j < ranges[i].size(); j++)
+			{
+				cout << "\t" << GetFrameFileName(serial, ranges[i][j].fileNumber) << " FrameID " << ranges[i][j].frameId
+					<< " host " << ranges[i][j].hostTimestampNs << " camera " << ranges[i][j].cameraTimestampNs << endl;
+			}
+		}
+	}
+
+	return 0;
+}
+
+// This function builds catalogs for an existing recording. Frames are put in
+// frame number order; the modification time stands in for the grab time.
+int ImportRecording(const string & directory)
+{
+	DIR* dir = opendir(directory.c_str());
+	if (dir == NULL)
+	{
+		cout << "Unable to read " << directory << ". Aborting..." << endl << endl;
+		return -1;
+	}
+
+	// Serial -> (frame number, modification time)
+	map<string, vector<pair<uint64_t, uint64_t> > > frames;
+
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		const string name = entry->d_name;
+		const size_t dash = name.rfind('-');
+
+		if (name.compare(0, 4, "Cam-") != 0 || dash == string::npos || dash < 4 ||
+			name.size() < 5 || name.compare(name.size() - 4, 4, ".jpg") != 0)
+		{
+			continue;
+		}
+
+		struct stat fileStat;
+		if (stat((directory + "/" + name).c_str(), &fileStat) != 0)
+		{
+			continue;
+		}
+
+		const uint64_t modifiedNs = static_cast<uint64_t>(fileStat.st_mtim.tv_sec) * 1000000000ULL + fileStat.st_mtim.tv_nsec;
+		const uint64_t fileNumber = strtoull(name.c_str() + dash + 1, NULL, 10);
+
+		frames[name.substr(4, dash - 4)].push_back(make_pair(fileNumber, modifiedNs));
+	}
+	closedir(dir);
+
+	int result = 0;
+
+	for (map<string, vector<pair<uint64_t, uint64_t> > >::iterator it = frames.begin(); it != frames.end(); ++it)
+	{
+		sort(it->second.begin(), it->second.end());
+
+		const string path = GetFrameCatalogPath(directory, it->first);
+		remove(path.c_str());
+
+		FrameCatalogWriter catalog(4096);
+		if (catalog.Open(path, it->first) != 0)
+		{
+			cout << "Unable to create catalog of camera " << it->first << endl;
+			result = -1;
+			continue;
+		}
+
+		for (size_t i = 0; i < it->second.size(); i++)
+		{
+			FrameCatalogRecord record;
+			record.hostTimestampNs = it->second[i].second;
+			record.cameraTimestampNs = 0;
+			record.frameId = it->second[i].first;
+			record.fileNumber = it->second[i].first;
+			record.offset = 0;
+
+			catalog.Append(record);
+		}
+
+		catalog.Close();
+
+		cout << "Camera " << it->first << ": " << it->second.size() << " frames catalogued" << endl;
+	}
+
+	return result;
+}
+
+// This function takes care of initializing and deinitializing cameras.
+int RunMultipleCameras(CameraList camList, const string & directory)
+{
+	int result = 0;
+	CameraPtr pCam = NULL;
+
+	try
+	{
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			pCam->Init();
+		}
+
+		result = result | RecordImages(camList, directory);
+
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			pCam->DeInit();
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// Example entry point; please see Enumeration example for more in-depth
+// comments on preparing and cleaning up the system.
+int main(int argc, char** argv)
+{
+	int result = 0;
+
+	// Lookups and imports need no camera
+	if (argc >= 4 && strcmp(argv[1], "-q") == 0)
+	{
+		double windowSeconds = 0.0;
+		if (argc >= 6 && strcmp(argv[4], "-w") == 0)
+		{
+			windowSeconds = atof(argv[5]);
+		}
+
+		return QueryCatalogs(argv[2], atof(argv[3]), windowSeconds);
+	}
+
+	if (argc >= 3 && strcmp(argv[1], "-i") == 0)
+	{
+		return ImportRecording(argv[2]);
+	}
+
+	string directory = k_defaultDirectory;
+	if (argc >= 3 && strcmp(argv[1], "-r") == 0)
+	{
+		directory = argv[2];
+	}
+
+	mkdir(directory.c_str(), 0755);
+
+	// Retrieve singleton reference to system object
+	SystemPtr system = System::GetInstance();
+
+	// Retrieve list of cameras from the system
+	CameraList camList = system->GetCameras();
+
+	unsigned int numCameras = camList.GetSize();
+
+	cout << "Number of cameras detected: " << numCameras << endl << endl;
+
+	// Finish if there are no cameras
+	if (numCameras == 0)
+	{
+		// Clear camera list before releasing system
+		camList.Clear();
+
+		// Release system
+		system->ReleaseInstance();
+
+		cout << "Not enough cameras!" << endl;
+		cout << "Done! Press Enter to exit..." << endl;
+		getchar();
+
+		return -1;
+	}
+
+	result = RunMultipleCameras(camList, directory);
+
+	// Clear camera list before releasing system
+	camList.Clear();
+
+	// Release system
+	system->ReleaseInstance();
+
+	cout << endl << "Done! Press Enter to exit..." << endl;
+	getchar();
+
+	return result;
+}
@@ -0,0 +1,364 @@
+/**
+ *	@example Governor.cpp
+ *
+ *	@brief Governor.cpp runs every camera at the rate its consumer can
+ *	actually keep up with (see Abhi_common/FrameRateGovernor.h), instead of
+ *	letting it free-run the way Abhi_test1 does and dropping what the host
+ *	cannot process.
+ *
+ *	Each camera has a consumer thread that converts, resizes and JPEG-encodes
+ *	its frames, fed through a short queue. A frame that finds the queue full
+ *	is dropped. Twice a second the governor of each camera compares the
+ *	camera rate with the measured consumer capacity and, with hysteresis,
+ *	writes AcquisitionFrameRate. At the end the frames received, processed
+ *	and dropped are printed per camera.
+ *
+ *	Usage: Governor [-s seconds] [-l extra-ms-per-frame] [-n]
+ *		-l adds work per frame to the consumers to make them slower than the
+ *		camera; -n leaves the cameras free-running for comparison.
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/opencv.hpp>
+#include "BoundedQueue.h"
+#include "FrameRateGovernor.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+using namespace cv;
+
+// Default run time
+const double k_defaultRunSeconds = 60.0;
+
+// Frames waiting per camera; below the stream's buffer count so the camera
+// is not starved of buffers
+const size_t k_queueCapacity = 4;
+
+// Time between governor updates
+const double k_updateIntervalSeconds = 0.5;
+
+// Work done per frame by the consumers, as in the display path
+const int k_previewWidth = 640;
+const int k_previewHeight = 480;
+const int k_jpegQuality = 75;
+
+// State of one camera and its consumer
+struct GovernedCamera
+{
+	GovernedCamera(CameraPtr camera) : pCam(camera), governor(camera), frames(k_queueCapacity),
+		numReceived(0), numProcessed(0), numDropped(0)
+	{
+	}
+
+	CameraPtr pCam;
+	FrameRateGovernor governor;
+	BoundedQueue<ImagePtr> frames;
+	thread consumer;
+
+	atomic<unsigned long long> numReceived;
+	atomic<unsigned long long> numProcessed;
+	atomic<unsigned long long> numDropped;
+};
+
+atomic<bool> g_stop(false);
+
+// This function processes the frames of one camera until stopped and
+// reports the time each one took to the governor.
+void ConsumeFrames(GovernedCamera & cam, double extraMs)
+{
+	vector<uchar> encoded;
+	vector<int> params;
+	params.push_back(IMWRITE_JPEG_QUALITY);
+	params.push_back(k_jpegQuality);
+
+	while (true)
+	{
+		ImagePtr pImage;
+		if (!cam.frames.Pop(pImage, 100))
+		{
+			if (g_stop)
+			{
+				break;
+			}
+			continue;
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		try
+		{
+			ImagePtr convertedImage = pImage->Convert(PixelFormat_BGR8, HQ_LINEAR);
+
+			Mat image = cv::Mat(convertedImage->GetHeight(), convertedImage->GetWidth(), CV_8UC3,
+				convertedImage->GetData(), convertedImage->GetStride());
+
+			Mat preview;
+			cv::resize(image, preview, Size(k_previewWidth, k_previewHeight), 0, 0, INTER_LINEAR);
+			cv::imencode(".jpg", preview, encoded, params);
+
+			if (extraMs > 0.0)
+			{
+				this_thread::sleep_for(chrono::duration<double, milli>(extraMs));
+			}
+
+			cam.numProcessed++;
+		}
+		catch (Spinnaker::Exception &e)
+		{
+			cout << "Error: " << e.what() << endl;
+		}
+
+		pImage->Release();
+
+		cam.governor.GetController().ReportConsumed(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+	}
+}
+
+// This function acquires from all cameras for the given time, governing
+// their rates unless freeRun is set.
+int AcquireImages(CameraList camList, double runSeconds, double extraMs, bool freeRun)
+{
+	int result = 0;
+	CameraPtr pCam = NULL;
+
+	cout << endl << "*** FRAME RATE GOVERNOR ***" << endl << endl;
+
+	vector<GovernedCamera*> cameras;
+
+	try
+	{
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			CEnumerationPtr ptrAcquisitionMode = pCam->GetNodeMap().GetNode("AcquisitionMode");
+			if (!IsAvailable(ptrAcquisitionMode) || !IsWritable(ptrAcquisitionMode))
+			{
+				cout << "Unable to set acquisition mode to continuous (node retrieval; camera " << i << "). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			CEnumEntryPtr ptrAcquisitionModeContinuous = ptrAcquisitionMode->GetEntryByName("Continuous");
+			if (!IsAvailable(ptrAcquisitionModeContinuous) || !IsReadable(ptrAcquisitionModeContinuous))
+			{
+				cout << "Unable to set acquisition mode to continuous (entry 'continuous' retrieval " << i << "). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			ptrAcquisitionMode->SetIntValue(ptrAcquisitionModeContinuous->GetValue());
+
+			cameras.push_back(new GovernedCamera(pCam));
+
+			if (!freeRun && cameras[i]->governor.Enable() == 0)
+			{
+				cout << "Camera " << i << " governed, starting at " << cameras[i]->governor.GetFrameRate() << " fps" << endl;
+			}
+			else
+			{
+				cout << "Camera " << i << " free-running" << endl;
+			}
+
+			cameras[i]->consumer = thread(ConsumeFrames, ref(*cameras[i]), extraMs);
+
+			pCam->BeginAcquisition();
+
+			cout << "Camera " << i << " started acquiring images..." << endl;
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		double lastUpdate = 0.0;
+		double elapsed = 0.0;
+
+		while (elapsed < runSeconds)
+		{
+			for (unsigned int i = 0; i < cameras.size(); i++)
+			{
+				try
+				{
+					ImagePtr pResultImage = cameras[i]->pCam->GetNextImage();
+					cameras[i]->numReceived++;
+
+					if (pResultImage->IsIncomplete())
+					{
+						cout << "Image incomplete with image status " << pResultImage->GetImageStatus() << "..." << endl << endl;
+						pResultImage->Release();
+					}
+					else if (!cameras[i]->frames.TryPush(pResultImage))
+					{
+						// Consumer behind: this is the frame the governor
+						// should have kept the camera from sending
+						pResultImage->Release();
+						cameras[i]->numDropped++;
+						cameras[i]->governor.GetController().ReportDropped();
+					}
+				}
+				catch (Spinnaker::Exception &e)
+				{
+					cout << "Error: " << e.what() << endl;
+					result = -1;
+				}
+			}
+
+			elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+			if (elapsed - lastUpdate >= k_updateIntervalSeconds)
+			{
+				for (unsigned int i = 0; i < cameras.size() && !freeRun; i++)
+				{
+					if (cameras[i]->governor.Update(elapsed, elapsed - lastUpdate, cameras[i]->frames.Size()) > 0)
+					{
+						cout << elapsed << " s: camera " << i << " set to " << cameras[i]->governor.GetFrameRate()
+							<< " fps (consumer capacity " << cameras[i]->governor.GetController().GetCapacity() << " fps)" << endl;
+					}
+				}
+				lastUpdate = elapsed;
+			}
+		}
+
+		g_stop = true;
+
+		cout << endl;
+
+		for (unsigned int i = 0; i < cameras.size(); i++)
+		{
+			cameras[i]->consumer.join();
+
+			// Release what the consumer left behind
+			ImagePtr pImage;
+			while (cameras[i]->frames.TryPop(pImage))
+			{
+				pImage->Release();
+			}
+
+			cameras[i]->pCam->EndAcquisition();
+			cameras[i]->governor.Disable();
+
+			cout << "Camera " << i << ": " << cameras[i]->numReceived << " received, " << cameras[i]->numProcessed
+				<< " processed, " << cameras[i]->numDropped << " dropped ("
+				<< cameras[i]->numProcessed / runSeconds << " fps processed)" << endl;
+
+			delete cameras[i];
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function takes care of initializing and deinitializing cameras.
+int RunMultipleCameras(CameraList camList, double runSeconds, double extraMs, bool freeRun)
+{
+	int result = 0;
+	CameraPtr pCam = NULL;
+
+	try
+	{
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			pCam->Init();
+		}
+
+		result = result | AcquireImages(camList, runSeconds, extraMs, freeRun);
+
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			pCam->DeInit();
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// Example entry point; please see Enumeration example for more in-depth
+// comments on preparing and cleaning up the system.
+int main(int argc, char** argv)
+{
+	int result = 0;
+
+	double runSeconds = k_defaultRunSeconds;
+	double extraMs = 0.0;
+	bool freeRun = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+		{
+			runSeconds = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+		{
+			extraMs = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-n") == 0)
+		{
+			freeRun = true;
+		}
+	}
+
+	// Retrieve singleton reference to system object
+	SystemPtr system = System::GetInstance();
+
+	// Retrieve list of cameras from the system
+	CameraList camList = system->GetCameras();
+
+	unsigned int numCameras = camList.GetSize();
+
+	cout << "Number of cameras detected: " << numCameras << endl << endl;
+
+	// Finish if there are no cameras
+	if (numCameras == 0)
+	{
+		// Clear camera list before releasing system
+		camList.Clear();
+
+		// Release system
+		system->ReleaseInstance();
+
+		cout << "Not enough cameras!" << endl;
+		cout << "Done! Press Enter to exit..." << endl;
+		getchar();
+
+		return -1;
+	}
+
+	result = RunMultipleCameras(camList, runSeconds, extraMs, freeRun);
+
+	// Clear camera list before releasing system
+	camList.Clear();
+
+	// Release system
+	system->ReleaseInstance();
+
+	cout << endl << "Done! Press Enter to exit..." << endl;
+	getchar();
+
+	return result;
+}
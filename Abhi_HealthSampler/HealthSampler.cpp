@@ -0,0 +1,248 @@
+/**
+ *	@example HealthSampler.cpp
+ *
+ *	@brief HealthSampler.cpp streams from all connected cameras while a
+ *	DeviceHealthSampler (see Abhi_common) polls device temperature, link error
+ *	and transport-layer frame counters in the background. It relies on
+ *	information provided in the AcquisitionMultipleCamera example.
+ *
+ *	The grab loop itself only counts frames; all node reads happen on the
+ *	sampler thread at k_samplePeriodMs. Values and alarm counts are published to
+ *	a MetricsRegistry and printed when acquisition ends. Alarms are printed as
+ *	they are raised.
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <iostream>
+#include <sstream>
+#include <sys/timeb.h>
+#include "MetricsRegistry.h"
+#include "DeviceHealthSampler.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+
+// Sampling period of the health nodes
+const unsigned int k_samplePeriodMs = 1000;
+
+// Length of the acquisition
+const int k_acquisitionMs = 60000;
+
+int getMilliCount(){
+	timeb tb;
+	ftime(&tb);
+	int nCount = tb.millitm + (tb.time & 0xfffff) * 1000;
+	return nCount;
+}
+
+int getMilliSpan(int nTimeStart){
+	int nSpan = getMilliCount() - nTimeStart;
+	if(nSpan < 0)
+		nSpan += 0x100000 * 1000;
+	return nSpan;
+}
+
+// This function streams from every camera for k_acquisitionMs and publishes
+// per-camera frame counters. Health sampling runs on its own thread meanwhile.
+int AcquireImages(CameraList camList, MetricsRegistry & metrics)
+{
+	int result = 0;
+	CameraPtr pCam = NULL;
+
+	cout << endl << "*** IMAGE ACQUISITION ***" << endl << endl;
+
+	try
+	{
+		// Prepare each camera to acquire images
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			// Select camera
+			pCam = camList.GetByIndex(i);
+
+			// Set acquisition mode to continuous
+			CEnumerationPtr ptrAcquisitionMode = pCam->GetNodeMap().GetNode("AcquisitionMode");
+			if (!IsAvailable(ptrAcquisitionMode) || !IsWritable(ptrAcquisitionMode))
+			{
+				cout << "Unable to set acquisition mode to continuous (node retrieval; camera " << i << "). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			CEnumEntryPtr ptrAcquisitionModeContinuous = ptrAcquisitionMode->GetEntryByName("Continuous");
+			if (!IsAvailable(ptrAcquisitionModeContinuous) || !IsReadable(ptrAcquisitionModeContinuous))
+			{
+				cout << "Unable to set acquisition mode to continuous (entry 'continuous' retrieval " << i << "). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			ptrAcquisitionMode->SetIntValue(ptrAcquisitionModeContinuous->GetValue());
+
+			// Begin acquiring images
+			pCam->BeginAcquisition();
+
+			cout << "Camera " << i << " started acquiring images..." << endl;
+		}
+
+		// Metric names are built once, not per frame
+		vector<string> grabbedNames(camList.GetSize());
+		vector<string> incompleteNames(camList.GetSize());
+
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			ostringstream label;
+			label << "cam" << i;
+
+			grabbedNames[i] = label.str() + ".FramesGrabbed";
+			incompleteNames[i] = label.str() + ".FramesIncomplete";
+		}
+
+		// Retrieve images from each camera in turn
+		int start = getMilliCount();
+
+		while (getMilliSpan(start) < k_acquisitionMs)
+		{
+			for (unsigned int i = 0; i < camList.GetSize(); i++)
+			{
+				try
+				{
+					pCam = camList.GetByIndex(i);
+
+					ImagePtr pResultImage = pCam->GetNextImage();
+
+					if (pResultImage->IsIncomplete())
+					{
+						metrics.AddCounter(incompleteNames[i]);
+					}
+					else
+					{
+						metrics.AddCounter(grabbedNames[i]);
+					}
+
+					pResultImage->Release();
+				}
+				catch (Spinnaker::Exception &e)
+				{
+					cout << "Error: " << e.what() << endl;
+					result = -1;
+				}
+			}
+		}
+
+		// End acquisition for each camera
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			camList.GetByIndex(i)->EndAcquisition();
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function initializes the cameras, attaches them to the health sampler,
+// runs the acquisition and prints the collected metrics.
+int RunMultipleCameras(CameraList camList)
+{
+	int result = 0;
+	CameraPtr pCam = NULL;
+
+	try
+	{
+		MetricsRegistry metrics;
+		DeviceHealthSampler sampler(metrics, k_samplePeriodMs);
+
+		// Initialize each camera and cache its health nodes
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			pCam->Init();
+
+			ostringstream label;
+			label << "cam" << i;
+
+			unsigned int numNodes = sampler.AddCamera(pCam, label.str());
+
+			cout << "Camera " << i << ": sampling " << numNodes << " health nodes..." << endl;
+		}
+
+		sampler.Start();
+
+		// Acquire images on all cameras
+		result = result | AcquireImages(camList, metrics);
+
+		// Stop sampling before any camera is deinitialized
+		sampler.Stop();
+
+		cout << endl << "*** METRICS AFTER " << sampler.GetSampleCount() << " HEALTH SAMPLES ***" << endl << endl;
+		metrics.Print();
+		cout << endl;
+
+		// Deinitialize each camera
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			pCam->DeInit();
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// Example entry point; please see Enumeration example for more in-depth
+// comments on preparing and cleaning up the system.
+int main(int /*argc*/, char** /*argv*/)
+{
+	int result = 0;
+
+	// Retrieve singleton reference to system object
+	SystemPtr system = System::GetInstance();
+
+	// Retrieve list of cameras from the system
+	CameraList camList = system->GetCameras();
+
+	unsigned int numCameras = camList.GetSize();
+
+	cout << "Number of cameras detected: " << numCameras << endl << endl;
+
+	// Finish if there are no cameras
+	if (numCameras == 0)
+	{
+		// Clear camera list before releasing system
+		camList.Clear();
+
+		// Release system
+		system->ReleaseInstance();
+
+		cout << "Not enough cameras!" << endl;
+		cout << "Done! Press Enter to exit..." << endl;
+		getchar();
+
+		return -1;
+	}
+
+	result = RunMultipleCameras(camList);
+
+	// Clear camera list before releasing system
+	camList.Clear();
+
+	// Release system
+	system->ReleaseInstance();
+
+	cout << endl << "Done! Press Enter to exit..." << endl;
+	getchar();
+
+	return result;
+}
@@ -0,0 +1,480 @@
+/**
+ *	@example JournaledRecording.cpp
+ *
+ *	@brief JournaledRecording.cpp records raw frames from all cameras into
+ *	crash-safe journaled recordings (see Abhi_common/JournaledRecording.h),
+ *	one Cam-<serial>.jrn file per camera. Unlike SaveToAvi, where the AVI
+ *	index is only written by AVIClose(), a recording cut short by a crash or
+ *	a kill can be recovered up to its last consistent frame and exported to
+ *	AVI afterwards.
+ *
+ *	Every frame gets a CRC-32C checksum as it arrives, before anything else
+ *	touches it. The checksum is kept in the recording's index and checked
+ *	whenever the frame is read (-verify, -export, Transcode), so corruption
+ *	after arrival can be told apart from corruption on the wire, where the
+ *	frame is already incomplete. The time taken by the checksum is printed
+ *	as a share of the frame interval.
+ *
+ *	Usage:
+ *		JournaledRecording [-r directory]
+ *			record k_numImages frames per camera into directory
+ *		JournaledRecording -recover file [-full]
+ *			make a recording readable again after a crash; -full checks
+ *			every frame instead of only the end of the file
+ *		JournaledRecording -verify file
+ *			check every frame against its checksum
+ *		JournaledRecording -export file output [-f frame-rate]
+ *			write the frames to an MJPG AVI file (output.avi)
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include "AVIRecorder.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "JournaledRecording.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+
+// Frames recorded per camera
+const unsigned int k_numImages = 1000;
+
+// Default recording directory
+const char* k_defaultDirectory = "recording";
+
+// Frames per index block, and time between fdatasync() calls
+const unsigned int k_indexInterval = 32;
+const unsigned int k_syncIntervalMs = 500;
+
+// This helper returns the wall clock in ns since the epoch.
+uint64_t GetHostTimestampNs()
+{
+	return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+		chrono::system_clock::now().time_since_epoch()).count());
+}
+
+// This helper returns the seconds elapsed since start.
+double GetSecondsSince(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// This function records raw frames from all cameras, one journaled
+// recording per camera. A recording is opened at the first frame of its
+// camera, once the image size and pixel format are known.
+int RecordImages(CameraList camList, const string & directory)
+{
+	int result = 0;
+	CameraPtr pCam = NULL;
+
+	cout << endl << "*** JOURNALED RECORDING ***" << endl << endl;
+
+	try
+	{
+		vector<string> serialNumbers(camList.GetSize());
+		vector<JournaledRecorder*> recorders;
+
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			CEnumerationPtr ptrAcquisitionMode = pCam->GetNodeMap().GetNode("AcquisitionMode");
+			if (!IsAvailable(ptrAcquisitionMode) || !IsWritable(ptrAcquisitionMode))
+			{
+				cout << "Unable to set acquisition mode to continuous (node retrieval; camera " << i << "). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			CEnumEntryPtr ptrAcquisitionModeContinuous = ptrAcquisitionMode->GetEntryByName("Continuous");
+			if (!IsAvailable(ptrAcquisitionModeContinuous) || !IsReadable(ptrAcquisitionModeContinuous))
+			{
+				cout << "Unable to set acquisition mode to continuous (entry 'continuous' retrieval " << i << "). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			ptrAcquisitionMode->SetIntValue(ptrAcquisitionModeContinuous->GetValue());
+
+			ostringstream serial;
+			serial << i;
+
+			CStringPtr ptrStringSerial = pCam->GetTLDeviceNodeMap().GetNode("DeviceSerialNumber");
+			if (IsAvailable(ptrStringSerial) && IsReadable(ptrStringSerial))
+			{
+				serial.str(ptrStringSerial->GetValue().c_str());
+			}
+			serialNumbers[i] = serial.str();
+
+			recorders.push_back(new JournaledRecorder(k_indexInterval, k_syncIntervalMs));
+		}
+
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			camList.GetByIndex(i)->BeginAcquisition();
+
+			cout << "Camera " << serialNumbers[i] << " started acquiring images..." << endl;
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		uint64_t bytesWritten = 0;
+
+		// Checksum cost per camera, against the camera's frame interval
+		vector<double> checksumSeconds(camList.GetSize(), 0.0);
+		vector<uint64_t> firstTimestamps(camList.GetSize(), 0);
+		vector<uint64_t> lastTimestamps(camList.GetSize(), 0);
+
+		for (unsigned int imageCnt = 0; imageCnt < k_numImages && result == 0; imageCnt++)
+		{
+			for (unsigned int i = 0; i < camList.GetSize(); i++)
+			{
+				try
+				{
+					pCam = camList.GetByIndex(i);
+
+					ImagePtr pResultImage = pCam->GetNextImage();
+					const uint64_t hostTimestampNs = GetHostTimestampNs();
+
+					if (pResultImage->IsIncomplete())
+					{
+						cout << "Image incomplete with image status " << pResultImage->GetImageStatus() << "..." << endl << endl;
+					}
+					else
+					{
+						// The checksum is taken once, as the frame arrives, so
+						// any later change to the data (in memory, on disk)
+						// shows up when it is verified on read
+						chrono::steady_clock::time_point checksumStart = chrono::steady_clock::now();
+						const uint32_t imageCrc = Crc32c(pResultImage->GetData(), pResultImage->GetImageSize());
+						checksumSeconds[i] += GetSecondsSince(checksumStart);
+
+						if (firstTimestamps[i] == 0)
+						{
+							firstTimestamps[i] = pResultImage->GetTimeStamp();
+						}
+						lastTimestamps[i] = pResultImage->GetTimeStamp();
+
+						if (!recorders[i]->IsOpen())
+						{
+							const string path = directory + "/Cam-" + serialNumbers[i] + ".jrn";
+
+							if (recorders[i]->Open(path, static_cast<uint32_t>(pResultImage->GetWidth()),
+								static_cast<uint32_t>(pResultImage->GetHeight()),
+								static_cast<uint32_t>(pResultImage->GetPixelFormat()), serialNumbers[i]) != 0)
+							{
+								cout << "Unable to create " << path << ". Aborting..." << endl << endl;
+								result = -1;
+							}
+						}
+
+						// Raw data is stored as is; conversion happens at export
+						if (result == 0 && recorders[i]->Append(pResultImage->GetData(), pResultImage->GetImageSize(),
+							pResultImage->GetFrameID(), hostTimestampNs, pResultImage->GetTimeStamp(), imageCrc, true) != 0)
+						{
+							cout << "Unable to write frame of camera " << serialNumbers[i] << ". Aborting..." << endl << endl;
+							result = -1;
+						}
+
+						bytesWritten += pResultImage->GetImageSize();
+					}
+
+					pResultImage->Release();
+				}
+				catch (Spinnaker::Exception &e)
+				{
+					cout << "Error: " << e.what() << endl;
+					result = -1;
+				}
+			}
+		}
+
+		const double seconds = GetSecondsSince(start);
+
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+			if (pCam->IsStreaming())
+			{
+				pCam->EndAcquisition();
+			}
+
+			const uint64_t numFrames = recorders[i]->GetNumFrames();
+
+			cout << "Camera " << serialNumbers[i] << ": " << numFrames << " frames" << endl;
+
+			if (numFrames > 1 && lastTimestamps[i] > firstTimestamps[i])
+			{
+				const double checksumUs = checksumSeconds[i] / numFrames * 1e6;
+				const double frameIntervalUs = (lastTimestamps[i] - firstTimestamps[i]) / 1e3 / (numFrames - 1);
+
+				cout << "\tchecksum " << checksumUs << " us per frame, " << 100.0 * checksumUs / frameIntervalUs
+					<< "% of the " << frameIntervalUs << " us frame interval"
+					<< (HasHardwareCrc32c() ? " (SSE4.2)" : " (table)") << endl;
+			}
+
+			if (recorders[i]->Close() != 0)
+			{
+				cout << "Unable to close recording of camera " << serialNumbers[i] << endl;
+				result = -1;
+			}
+
+			delete recorders[i];
+		}
+
+		cout << endl << "Recorded " << bytesWritten / 1e6 << " MB in " << seconds << " s ("
+			<< bytesWritten / 1e6 / seconds << " MB/s)" << endl;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function recovers a recording cut short by a crash.
+int RecoverRecording(const string & path, bool full)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	JournalRecoveryReport report;
+	if (RecoverJournal(path, report, full ? 0 : k_journalVerifyTailBytes) != 0)
+	{
+		cout << "Unable to recover " << path << ". Aborting..." << endl << endl;
+		return -1;
+	}
+
+	if (report.wasClean)
+	{
+		cout << path << " was closed cleanly: " << report.numFrames << " frames" << endl;
+		return 0;
+	}
+
+	cout << "Recovered " << path << " in " << GetSecondsSince(start) << " s" << endl;
+	cout << "\t" << report.numFrames << " frames (" << report.numIndexedFrames << " already indexed, "
+		<< report.numFramesReindexed << " indexed now)" << endl;
+	cout << "\t" << report.bytesCut << " bytes cut from the end" << endl;
+
+	return 0;
+}
+
+// This function checks every frame of a recording against its checksum.
+int VerifyRecording(const string & path)
+{
+	JournaledReader reader;
+
+	int openResult = reader.Open(path);
+	if (openResult == -2)
+	{
+		cout << path << " was not closed cleanly; run with -recover first. Aborting..." << endl << endl;
+		return -1;
+	}
+	else if (openResult != 0)
+	{
+		cout << "Unable to open " << path << ". Aborting..." << endl << endl;
+		return -1;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	vector<uint8_t> image;
+	uint64_t bytesRead = 0;
+	size_t numBadFrames = 0;
+
+	for (size_t i = 0; i < reader.GetNumFrames(); i++)
+	{
+		int readResult = reader.ReadFrame(i, image);
+		if (readResult != 0)
+		{
+			cout << "Frame " << i << " (FrameID " << reader.GetEntry(i).frameId << "): "
+				<< (readResult == -2 ? "checksum mismatch" : "read error") << endl;
+			numBadFrames++;
+		}
+		bytesRead += image.size();
+	}
+
+	const double seconds = GetSecondsSince(start);
+
+	cout << reader.GetNumFrames() << " frames checked, " << numBadFrames << " bad ("
+		<< bytesRead / 1e6 / seconds << " MB/s)" << endl;
+
+	return numBadFrames == 0 ? 0 : -1;
+}
+
+// This function writes the frames of a recording to an MJPG AVI file.
+int ExportRecording(const string & path, const string & output, float frameRate)
+{
+	int result = 0;
+
+	JournaledReader reader;
+	if (reader.Open(path) != 0)
+	{
+		cout << "Unable to open " << path << " (run with -recover after a crash). Aborting..." << endl << endl;
+		return -1;
+	}
+
+	const JournalFileHeader & header = reader.GetHeader();
+	const PixelFormatEnums pixelFormat = static_cast<PixelFormatEnums>(header.pixelFormat);
+
+	try
+	{
+		AVIRecorder aviRecorder;
+
+		MJPGOption option;
+		option.frameRate = frameRate;
+		option.quality = 75;
+
+		aviRecorder.AVIOpen(output.c_str(), option);
+
+		vector<uint8_t> data;
+
+		for (size_t i = 0; i < reader.GetNumFrames(); i++)
+		{
+			if (reader.ReadFrame(i, data) != 0)
+			{
+				cout << "Skipping bad frame " << i << endl;
+				continue;
+			}
+
+			ImagePtr rawImage = Image::Create(header.width, header.height, 0, 0, pixelFormat, &data[0]);
+
+			if (pixelFormat == PixelFormat_Mono8)
+			{
+				aviRecorder.AVIAppend(rawImage);
+			}
+			else
+			{
+				aviRecorder.AVIAppend(rawImage->Convert(PixelFormat_BGR8, HQ_LINEAR));
+			}
+		}
+
+		aviRecorder.AVIClose();
+
+		cout << reader.GetNumFrames() << " frames exported to " << output << ".avi" << endl;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function takes care of initializing and deinitializing cameras.
+int RunMultipleCameras(CameraList camList, const string & directory)
+{
+	int result = 0;
+	CameraPtr pCam = NULL;
+
+	try
+	{
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			pCam->Init();
+		}
+
+		result = result | RecordImages(camList, directory);
+
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			pCam->DeInit();
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// Example entry point; please see Enumeration example for more in-depth
+// comments on preparing and cleaning up the system.
+int main(int argc, char** argv)
+{
+	int result = 0;
+
+	// Recovery, verification and export need no camera
+	if (argc >= 3 && strcmp(argv[1], "-recover") == 0)
+	{
+		return RecoverRecording(argv[2], argc >= 4 && strcmp(argv[3], "-full") == 0);
+	}
+
+	if (argc >= 3 && strcmp(argv[1], "-verify") == 0)
+	{
+		return VerifyRecording(argv[2]);
+	}
+
+	if (argc >= 4 && strcmp(argv[1], "-export") == 0)
+	{
+		float frameRate = 15.0f;
+		if (argc >= 6 && strcmp(argv[4], "-f") == 0)
+		{
+			frameRate = static_cast<float>(atof(argv[5]));
+		}
+
+		return ExportRecording(argv[2], argv[3], frameRate);
+	}
+
+	string directory = k_defaultDirectory;
+	if (argc >= 3 && strcmp(argv[1], "-r") == 0)
+	{
+		directory = argv[2];
+	}
+
+	mkdir(directory.c_str(), 0755);
+
+	// Retrieve singleton reference to system object
+	SystemPtr system = System::GetInstance();
+
+	// Retrieve list of cameras from the system
+	CameraList camList = system->GetCameras();
+
+	unsigned int numCameras = camList.GetSize();
+
+	cout << "Number of cameras detected: " << numCameras << endl << endl;
+
+	// Finish if there are no cameras
+	if (numCameras == 0)
+	{
+		// Clear camera list before releasing system
+		camList.Clear();
+
+		// Release system
+		system->ReleaseInstance();
+
+		cout << "Not enough cameras!" << endl;
+		cout << "Done! Press Enter to exit..." << endl;
+		getchar();
+
+		return -1;
+	}
+
+	result = RunMultipleCameras(camList, directory);
+
+	// Clear camera list before releasing system
+	camList.Clear();
+
+	// Release system
+	system->ReleaseInstance();
+
+	cout << endl << "Done! Press Enter to exit..." << endl;
+	getchar();
+
+	return result;
+}
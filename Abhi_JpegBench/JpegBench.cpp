@@ -0,0 +1,274 @@
+/**
+ *	@example JpegBench.cpp
+ *
+ *	@brief JpegBench.cpp measures how long JPEG-encoding a single frame takes
+ *	with cv::imencode() and with the striped encoder (see
+ *	Abhi_common/StripedJpegEncoder.h) at 1, 2, 4, ... threads. One frame's
+ *	latency is what caps the frame rate of a camera whose frames are all
+ *	saved, so the median and worst latency per frame are printed, not the
+ *	throughput of several frames in flight. No camera is needed; frames come
+ *	from SyntheticCamera.
+ *
+ *	Every striped JPEG is decoded and compared with the decoded
+ *	single-stripe JPEG; the two must match pixel for pixel.
+ *
+ *	With -d, one frame of each case is also saved through both FrameWriter
+ *	implementations, the way the save paths use them.
+ *
+ *	Usage: JpegBench [-n frames] [-t max-threads] [-q quality] [-d directory]
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/opencv.hpp>
+#include "FrameWriter.h"
+#include "StripedJpegEncoder.h"
+#include "StripeWorkerPool.h"
+#include "SyntheticCamera.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+using namespace cv;
+
+// Frames encoded per case and thread count
+const unsigned int k_defaultNumFrames = 20;
+
+// JPEG quality, as in SaveToAvi
+const int k_defaultQuality = 75;
+
+struct JpegBenchCase
+{
+	const char* name;
+	unsigned int width;
+	unsigned int height;
+	unsigned int channels;
+};
+
+const JpegBenchCase k_cases[] =
+{
+	{ "mono8_1280x1024", 1280, 1024, 1 },
+	{ "bgr8_1280x1024", 1280, 1024, 3 },
+	{ "mono8_4000x3000", 4000, 3000, 1 },
+	{ "bgr8_4000x3000", 4000, 3000, 3 },
+};
+
+// FrameWriter on cv::imwrite(), the way the save paths wrote frames so far
+class OpenCvFrameWriter : public FrameWriter
+{
+public:
+
+	OpenCvFrameWriter(int quality) : m_quality(quality) {}
+
+	int Write(const string & path, const FrameView & frame)
+	{
+		Mat image = cv::Mat(static_cast<int>(frame.height), static_cast<int>(frame.width),
+			frame.channels == 1 ? CV_8UC1 : CV_8UC3, const_cast<uint8_t*>(frame.data), frame.stride);
+
+		vector<int> parameters;
+		parameters.push_back(IMWRITE_JPEG_QUALITY);
+		parameters.push_back(m_quality);
+
+		return cv::imwrite(path, image, parameters) ? 0 : -1;
+	}
+
+private:
+
+	int m_quality;
+};
+
+// This helper returns the median and maximum of a set of latencies.
+void GetLatencyStats(vector<double> latencies, double & median, double & maximum)
+{
+	sort(latencies.begin(), latencies.end());
+	median = latencies[latencies.size() / 2];
+	maximum = latencies.back();
+}
+
+// This helper decodes a JPEG; an empty Mat means it could not be decoded.
+Mat DecodeJpeg(const vector<uint8_t> & jpeg, unsigned int channels)
+{
+	return cv::imdecode(jpeg, channels == 1 ? IMREAD_GRAYSCALE : IMREAD_COLOR);
+}
+
+// This helper counts the bytes that differ between two decoded frames.
+size_t CountDifferences(const Mat & a, const Mat & b)
+{
+	if (a.empty() || b.empty() || a.rows != b.rows || a.cols != b.cols || a.channels() != b.channels())
+	{
+		return static_cast<size_t>(-1);
+	}
+
+	size_t differences = 0;
+	const size_t rowBytes = static_cast<size_t>(a.cols) * a.channels();
+
+	for (int y = 0; y < a.rows; y++)
+	{
+		const uint8_t* rowA = a.ptr(y);
+		const uint8_t* rowB = b.ptr(y);
+
+		for (size_t x = 0; x < rowBytes; x++)
+		{
+			differences += rowA[x] != rowB[x];
+		}
+	}
+
+	return differences;
+}
+
+// This function runs one case over all thread counts.
+int RunCase(const JpegBenchCase & benchCase, unsigned int numFrames, unsigned int maxThreads, int quality, const string & directory)
+{
+	int result = 0;
+
+	// Colour frames are the demosaiced Bayer frames of the synthetic camera
+	SyntheticCamera camera(benchCase.width, benchCase.height, benchCase.channels == 1 ? SYNTHETIC_MONO8 : SYNTHETIC_BAYER_RG8);
+	Mat raw = cv::Mat(benchCase.height, benchCase.width, CV_8UC1, const_cast<uint8_t*>(camera.NextFrame()), camera.GetStride());
+
+	Mat frame;
+	if (benchCase.channels == 1)
+	{
+		frame = raw.clone();
+	}
+	else
+	{
+		cv::cvtColor(raw, frame, COLOR_BayerBG2BGR);
+	}
+
+	const FrameView view(frame.ptr(), benchCase.width, benchCase.height, benchCase.channels, frame.step);
+
+	cout << benchCase.name << endl;
+
+	// cv::imencode() baseline
+	vector<double> latencies;
+	vector<uchar> cvJpeg;
+	vector<int> parameters;
+	parameters.push_back(IMWRITE_JPEG_QUALITY);
+	parameters.push_back(quality);
+
+	for (unsigned int n = 0; n < numFrames; n++)
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		cv::imencode(".jpg", frame, cvJpeg, parameters);
+		latencies.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	}
+
+	double median;
+	double maximum;
+	GetLatencyStats(latencies, median, maximum);
+	const double baseline = median;
+
+	printf("\t%-18s %8.2f ms median %8.2f ms max %9zu bytes\n", "cv::imencode", median, maximum, cvJpeg.size());
+
+	// Single stripe, the reference for the pixel comparison
+	StripeWorkerPool singlePool(1);
+	StripedJpegEncoder singleEncoder(singlePool, quality, 1);
+	vector<uint8_t> reference;
+
+	if (singleEncoder.Encode(view, reference) != 0)
+	{
+		cout << "Unable to encode " << benchCase.name << ". Aborting..." << endl << endl;
+		return -1;
+	}
+
+	const Mat decodedReference = DecodeJpeg(reference, benchCase.channels);
+
+	for (unsigned int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+	{
+		StripeWorkerPool pool(numThreads);
+		StripedJpegEncoder encoder(pool, quality);
+		vector<uint8_t> jpeg;
+
+		latencies.clear();
+		for (unsigned int n = 0; n < numFrames; n++)
+		{
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			result = result | encoder.Encode(view, jpeg);
+			latencies.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+		}
+
+		GetLatencyStats(latencies, median, maximum);
+
+		const size_t differences = CountDifferences(decodedReference, DecodeJpeg(jpeg, benchCase.channels));
+		if (differences != 0)
+		{
+			result = -1;
+		}
+
+		ostringstream label;
+		label << "striped x" << numThreads;
+
+		printf("\t%-18s %8.2f ms median %8.2f ms max %9zu bytes %5.2fx %s\n", label.str().c_str(), median, maximum,
+			jpeg.size(), baseline / median, differences == 0 ? "identical" : "MISMATCH");
+	}
+
+	if (!directory.empty())
+	{
+		StripeWorkerPool pool(maxThreads);
+		StripedJpegWriter stripedWriter(pool, quality);
+		OpenCvFrameWriter openCvWriter(quality);
+
+		result = result | stripedWriter.Write(directory + "/" + benchCase.name + "-striped.jpg", view);
+		result = result | openCvWriter.Write(directory + "/" + benchCase.name + "-opencv.jpg", view);
+	}
+
+	return result;
+}
+
+int main(int argc, char** argv)
+{
+	int result = 0;
+
+	unsigned int numFrames = k_defaultNumFrames;
+	unsigned int maxThreads = max(1u, thread::hardware_concurrency());
+	int quality = k_defaultQuality;
+	string directory;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-n") == 0)
+		{
+			numFrames = max(1, atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-t") == 0)
+		{
+			maxThreads = max(1, atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-q") == 0)
+		{
+			quality = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-d") == 0)
+		{
+			directory = argv[i + 1];
+		}
+	}
+
+	cout << endl << "*** SINGLE-FRAME JPEG LATENCY ***" << endl << endl;
+	cout << numFrames << " frames per case, quality " << quality << ", up to " << maxThreads << " threads" << endl << endl;
+
+	for (size_t i = 0; i < sizeof(k_cases) / sizeof(k_cases[0]); i++)
+	{
+		result = result | RunCase(k_cases[i], numFrames, maxThreads, quality, directory);
+	}
+
+	if (result != 0)
+	{
+		cout << endl << "Some cases failed." << endl;
+	}
+
+	return result;
+}
@@ -0,0 +1,263 @@
+/**
+ *	@example MarkerTracking.cpp
+ *
+ *	@brief MarkerTracking.cpp tracks bright markers on every connected camera
+ *	and prints their sub-pixel centroids together with the tracking latency.
+ *	It relies on information provided in the AcquisitionMultipleCamera example.
+ *
+ *	Each camera has its own BlobTracker (see Abhi_common/BlobTracker.h); all
+ *	trackers share one StripeWorkerPool. Frames already in Mono8 are tracked in
+ *	place, without Convert(). With k_usePredictedWindows set, only windows
+ *	around the previous centroids are processed between full-frame passes.
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <iostream>
+#include <sstream>
+#include "StripeWorkerPool.h"
+#include "BlobTracker.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+
+// Frames tracked per camera
+const unsigned int k_numImages = 2000;
+
+// Print results every this many frames
+const unsigned int k_printInterval = 100;
+
+// Tracking parameters
+const uint8_t k_threshold = 200;
+const bool k_usePredictedWindows = true;
+const int k_windowRadius = 24;
+
+// This function prints the centroids of the last frame and the latency so far.
+void PrintTrackingResult(unsigned int camNum, const BlobTracker & tracker)
+{
+	const BlobTrackerStats & stats = tracker.GetStats();
+	const vector<Blob> & blobs = tracker.GetBlobs();
+
+	cout << "Camera " << camNum << " frame " << stats.numFrames << ": " << blobs.size() << " markers, latency "
+		<< stats.lastUs << " us (mean " << stats.totalUs / stats.numFrames << " us, max " << stats.maxUs
+		<< " us, " << stats.numFullFrames << " full frames)" << endl;
+
+	for (size_t i = 0; i < blobs.size(); i++)
+	{
+		cout << "\t(" << blobs[i].centroidX << ", " << blobs[i].centroidY << ") area " << blobs[i].area << endl;
+	}
+}
+
+// This function grabs frames from each camera in turn and tracks markers.
+int AcquireImages(CameraList camList)
+{
+	int result = 0;
+	CameraPtr pCam = NULL;
+
+	cout << endl << "*** MARKER TRACKING ***" << endl << endl;
+
+	try
+	{
+		// Prepare each camera to acquire images
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			CEnumerationPtr ptrAcquisitionMode = pCam->GetNodeMap().GetNode("AcquisitionMode");
+			if (!IsAvailable(ptrAcquisitionMode) || !IsWritable(ptrAcquisitionMode))
+			{
+				cout << "Unable to set acquisition mode to continuous (node retrieval; camera " << i << "). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			CEnumEntryPtr ptrAcquisitionModeContinuous = ptrAcquisitionMode->GetEntryByName("Continuous");
+			if (!IsAvailable(ptrAcquisitionModeContinuous) || !IsReadable(ptrAcquisitionModeContinuous))
+			{
+				cout << "Unable to set acquisition mode to continuous (entry 'continuous' retrieval " << i << "). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			ptrAcquisitionMode->SetIntValue(ptrAcquisitionModeContinuous->GetValue());
+
+			pCam->BeginAcquisition();
+
+			cout << "Camera " << i << " started acquiring images..." << endl;
+		}
+
+		// One tracker per camera, sharing the worker threads
+		StripeWorkerPool pool;
+
+		BlobTrackerParams params;
+		params.threshold = k_threshold;
+		params.usePredictedWindows = k_usePredictedWindows;
+		params.windowRadius = k_windowRadius;
+
+		vector<BlobTracker*> trackers;
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			trackers.push_back(new BlobTracker(pool, params));
+		}
+
+		cout << "Tracking with " << pool.GetNumThreads() << " threads..." << endl << endl;
+
+		for (unsigned int imageCnt = 0; imageCnt < k_numImages; imageCnt++)
+		{
+			for (unsigned int i = 0; i < camList.GetSize(); i++)
+			{
+				try
+				{
+					pCam = camList.GetByIndex(i);
+
+					ImagePtr pResultImage = pCam->GetNextImage();
+
+					if (pResultImage->IsIncomplete())
+					{
+						cout << "Image incomplete with image status " << pResultImage->GetImageStatus() << "..." << endl << endl;
+					}
+					else
+					{
+						// Track Mono8 frames in place; convert anything else
+						ImagePtr monoImage = pResultImage;
+						if (pResultImage->GetPixelFormat() != PixelFormat_Mono8)
+						{
+							monoImage = pResultImage->Convert(PixelFormat_Mono8, NEAREST_NEIGHBOR);
+						}
+
+						size_t stride = monoImage->GetStride();
+						if (stride == 0)
+						{
+							stride = monoImage->GetImageSize() / monoImage->GetHeight();
+						}
+
+						trackers[i]->TrackFrame(static_cast<const uint8_t*>(monoImage->GetData()),
+							static_cast<int>(monoImage->GetWidth()), static_cast<int>(monoImage->GetHeight()), stride);
+
+						if ((imageCnt + 1) % k_printInterval == 0)
+						{
+							PrintTrackingResult(i, *trackers[i]);
+						}
+					}
+
+					pResultImage->Release();
+				}
+				catch (Spinnaker::Exception &e)
+				{
+					cout << "Error: " << e.what() << endl;
+					result = -1;
+				}
+			}
+		}
+
+		// Final latency summary
+		cout << endl;
+		for (unsigned int i = 0; i < trackers.size(); i++)
+		{
+			const BlobTrackerStats & stats = trackers[i]->GetStats();
+
+			if (stats.numFrames > 0)
+			{
+				cout << "Camera " << i << ": mean latency " << stats.totalUs / stats.numFrames << " us, max "
+					<< stats.maxUs << " us over " << stats.numFrames << " frames" << endl;
+			}
+
+			delete trackers[i];
+		}
+
+		// End acquisition for each camera
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			camList.GetByIndex(i)->EndAcquisition();
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function takes care of initializing and deinitializing cameras.
+int RunMultipleCameras(CameraList camList)
+{
+	int result = 0;
+	CameraPtr pCam = NULL;
+
+	try
+	{
+		// Initialize each camera
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			pCam->Init();
+		}
+
+		// Track markers on all cameras
+		result = result | AcquireImages(camList);
+
+		// Deinitialize each camera
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			pCam->DeInit();
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// Example entry point; please see Enumeration example for more in-depth
+// comments on preparing and cleaning up the system.
+int main(int /*argc*/, char** /*argv*/)
+{
+	int result = 0;
+
+	// Retrieve singleton reference to system object
+	SystemPtr system = System::GetInstance();
+
+	// Retrieve list of cameras from the system
+	CameraList camList = system->GetCameras();
+
+	unsigned int numCameras = camList.GetSize();
+
+	cout << "Number of cameras detected: " << numCameras << endl << endl;
+
+	// Finish if there are no cameras
+	if (numCameras == 0)
+	{
+		// Clear camera list before releasing system
+		camList.Clear();
+
+		// Release system
+		system->ReleaseInstance();
+
+		cout << "Not enough cameras!" << endl;
+		cout << "Done! Press Enter to exit..." << endl;
+		getchar();
+
+		return -1;
+	}
+
+	result = RunMultipleCameras(camList);
+
+	// Clear camera list before releasing system
+	camList.Clear();
+
+	// Release system
+	system->ReleaseInstance();
+
+	cout << endl << "Done! Press Enter to exit..." << endl;
+	getchar();
+
+	return result;
+}
@@ -0,0 +1,313 @@
+/**
+ *	@example NodeNotify.cpp
+ *
+ *	@brief NodeNotify.cpp compares synchronous nodemap callbacks with coalesced
+ *	notifications delivered off the SDK thread. It relies on information
+ *	provided in the NodeMapCallback example.
+ *
+ *	A controller that changes gain and exposure every frame is simulated by
+ *	writing both nodes in a tight loop. The loop is timed three times: without
+ *	any callback, with callbacks that print every change (as NodeMapCallback
+ *	does), and with a CoalescedNodeNotifier (see Abhi_common) that delivers one
+ *	batch per interval on a worker thread. Setter latency is printed for each.
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include "CoalescedNodeNotifier.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+
+// Number of simulated controller updates per run
+const unsigned int k_numUpdates = 200;
+
+// Interval at which coalesced batches are delivered
+const unsigned int k_notifyIntervalMs = 100;
+
+// Use the following enum to select how changes are reported during a run.
+enum notifyMode
+{
+	NO_CALLBACK,
+	SYNCHRONOUS_CALLBACK,
+	COALESCED_NOTIFIER
+};
+
+// Synchronous callbacks as in the NodeMapCallback example; these run inside
+// the setter.
+void OnGainNodeUpdate(INode* node)
+{
+	CFloatPtr ptrGain = node;
+
+	cout << "Gain callback message:" << endl;
+	cout << "\tGain changed to " << ptrGain->GetValue() << "..." << endl;
+}
+
+void OnExposureNodeUpdate(INode* node)
+{
+	CFloatPtr ptrExposureTime = node;
+
+	cout << "Exposure callback message:" << endl;
+	cout << "\tExposure time changed to " << ptrExposureTime->GetValue() << "..." << endl;
+}
+
+// Handler for coalesced batches; runs on the notifier's worker thread.
+void OnNodeChangeBatch(const NodeChangeBatch & batch)
+{
+	cout << "Coalesced batch message:" << endl;
+
+	for (size_t i = 0; i < batch.size(); i++)
+	{
+		cout << "\t" << batch[i].featureName << " = " << batch[i].value
+			<< " (" << batch[i].updateCount << " updates)" << endl;
+	}
+}
+
+// This function turns automatic gain and exposure off so both can be written.
+int DisableAutomaticControls(INodeMap & nodeMap)
+{
+	const char* autoNodes[] = { "GainAuto", "ExposureAuto" };
+
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		CEnumerationPtr ptrAuto = nodeMap.GetNode(autoNodes[i]);
+		if (!IsAvailable(ptrAuto) || !IsWritable(ptrAuto))
+		{
+			cout << "Unable to disable " << autoNodes[i] << " (node retrieval). Aborting..." << endl << endl;
+			return -1;
+		}
+
+		CEnumEntryPtr ptrAutoOff = ptrAuto->GetEntryByName("Off");
+		if (!IsAvailable(ptrAutoOff) || !IsReadable(ptrAutoOff))
+		{
+			cout << "Unable to disable " << autoNodes[i] << " (enum entry retrieval). Aborting..." << endl << endl;
+			return -1;
+		}
+
+		ptrAuto->SetIntValue(ptrAutoOff->GetValue());
+	}
+
+	cout << "Automatic gain and exposure disabled..." << endl;
+
+	return 0;
+}
+
+// This function restores automatic gain and exposure.
+int EnableAutomaticControls(INodeMap & nodeMap)
+{
+	const char* autoNodes[] = { "GainAuto", "ExposureAuto" };
+
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		CEnumerationPtr ptrAuto = nodeMap.GetNode(autoNodes[i]);
+		if (!IsAvailable(ptrAuto) || !IsWritable(ptrAuto))
+		{
+			cout << "Unable to enable " << autoNodes[i] << ". Non-fatal error..." << endl << endl;
+			return -1;
+		}
+
+		CEnumEntryPtr ptrAutoContinuous = ptrAuto->GetEntryByName("Continuous");
+		if (!IsAvailable(ptrAutoContinuous) || !IsReadable(ptrAutoContinuous))
+		{
+			cout << "Unable to enable " << autoNodes[i] << ". Non-fatal error..." << endl << endl;
+			return -1;
+		}
+
+		ptrAuto->SetIntValue(ptrAutoContinuous->GetValue());
+	}
+
+	cout << "Automatic gain and exposure enabled..." << endl;
+
+	return 0;
+}
+
+// This function writes gain and exposure k_numUpdates times each and reports
+// the mean and maximum time a single setter took.
+int RunControllerLoop(INodeMap & nodeMap, notifyMode mode)
+{
+	int result = 0;
+
+	try
+	{
+		CFloatPtr ptrGain = nodeMap.GetNode("Gain");
+		CFloatPtr ptrExposureTime = nodeMap.GetNode("ExposureTime");
+		if (!IsAvailable(ptrGain) || !IsWritable(ptrGain) ||
+			!IsAvailable(ptrExposureTime) || !IsWritable(ptrExposureTime))
+		{
+			cout << "Unable to retrieve gain and exposure time. Aborting..." << endl << endl;
+			return -1;
+		}
+
+		// Sweep over the lower part of each range so values always change
+		const double gainMin = ptrGain->GetMin();
+		const double gainStep = (ptrGain->GetMax() - gainMin) / (2.0 * k_numUpdates);
+		const double exposureMin = ptrExposureTime->GetMin();
+		const double exposureStep = (10000.0 - exposureMin) / k_numUpdates;
+
+		// Prepare the selected reporting mechanism
+		CallbackHandleType callbackGain = 0;
+		CallbackHandleType callbackExposure = 0;
+		CoalescedNodeNotifier notifier(k_notifyIntervalMs);
+
+		if (mode == SYNCHRONOUS_CALLBACK)
+		{
+			callbackGain = Register(ptrGain, &OnGainNodeUpdate);
+			callbackExposure = Register(ptrExposureTime, &OnExposureNodeUpdate);
+		}
+		else if (mode == COALESCED_NOTIFIER)
+		{
+			notifier.SetHandler(OnNodeChangeBatch);
+			notifier.Watch(nodeMap, "Gain");
+			notifier.Watch(nodeMap, "ExposureTime");
+			notifier.Start();
+		}
+
+		// Simulated controller
+		double totalUs = 0.0;
+		double maxUs = 0.0;
+
+		for (unsigned int i = 0; i < k_numUpdates; i++)
+		{
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+			ptrGain->SetValue(gainMin + gainStep * i);
+			ptrExposureTime->SetValue(exposureMin + exposureStep * i);
+
+			chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+
+			totalUs += elapsed.count();
+			if (elapsed.count() > maxUs)
+			{
+				maxUs = elapsed.count();
+			}
+		}
+
+		// Clean up; deregistration must happen before the camera is deinitialized
+		if (mode == SYNCHRONOUS_CALLBACK)
+		{
+			Deregister(callbackGain);
+			Deregister(callbackExposure);
+		}
+		else if (mode == COALESCED_NOTIFIER)
+		{
+			notifier.Stop();
+			notifier.Unwatch();
+
+			cout << endl << notifier.GetCallbackCount() << " changes delivered in "
+				<< notifier.GetBatchCount() << " batches..." << endl;
+		}
+
+		const char* modeNames[] = { "no callback", "synchronous callbacks", "coalesced notifier" };
+
+		cout << endl << "Setter latency with " << modeNames[mode] << ": mean "
+			<< totalUs / (2.0 * k_numUpdates) << " us per set, max "
+			<< maxUs << " us per gain+exposure update" << endl << endl;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function acts as the body of the example; please see NodeMapInfo example
+// for more in-depth comments on setting up cameras.
+int RunSingleCamera(CameraPtr pCam)
+{
+	int result = 0;
+
+	try
+	{
+		// Initialize camera
+		pCam->Init();
+
+		// Retrieve GenICam nodemap
+		INodeMap & nodeMap = pCam->GetNodeMap();
+
+		if (DisableAutomaticControls(nodeMap) != 0)
+		{
+			pCam->DeInit();
+			return -1;
+		}
+
+		cout << endl << "*** NO CALLBACK ***" << endl << endl;
+		result = result | RunControllerLoop(nodeMap, NO_CALLBACK);
+
+		cout << endl << "*** SYNCHRONOUS CALLBACKS ***" << endl << endl;
+		result = result | RunControllerLoop(nodeMap, SYNCHRONOUS_CALLBACK);
+
+		cout << endl << "*** COALESCED NOTIFIER ***" << endl << endl;
+		result = result | RunControllerLoop(nodeMap, COALESCED_NOTIFIER);
+
+		result = result | EnableAutomaticControls(nodeMap);
+
+		// Deinitialize camera
+		pCam->DeInit();
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// Example entry point; please see Enumeration example for more in-depth
+// comments on preparing and cleaning up the system.
+int main(int /*argc*/, char** /*argv*/)
+{
+	int result = 0;
+
+	// Retrieve singleton reference to system object
+	SystemPtr system = System::GetInstance();
+
+	// Retrieve list of cameras from the system
+	CameraList camList = system->GetCameras();
+
+	unsigned int numCameras = camList.GetSize();
+
+	cout << "Number of cameras detected: " << numCameras << endl << endl;
+
+	// Finish if there are no cameras
+	if (numCameras == 0)
+	{
+		// Clear camera list before releasing system
+		camList.Clear();
+
+		// Release system
+		system->ReleaseInstance();
+
+		cout << "Not enough cameras!" << endl;
+		cout << "Done! Press Enter to exit..." << endl;
+		getchar();
+
+		return -1;
+	}
+
+	// Run example on the first camera
+	CameraPtr pCam = camList.GetByIndex(0);
+
+	result = RunSingleCamera(pCam);
+
+	// Release reference to the camera before releasing the system
+	pCam = NULL;
+
+	// Clear camera list before releasing system
+	camList.Clear();
+
+	// Release system
+	system->ReleaseInstance();
+
+	cout << endl << "Done! Press Enter to exit..." << endl;
+	getchar();
+
+	return result;
+}
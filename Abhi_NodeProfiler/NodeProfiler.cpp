@@ -0,0 +1,345 @@
+/**
+ *	@example NodeProfiler.cpp
+ *
+ *	@brief NodeProfiler.cpp profiles the nodemap traffic of the chunk data and
+ *	lookup table configuration steps on every connected camera. It relies on
+ *	information provided in the ChunkData and LookupTable examples.
+ *
+ *	Each configuration step is the same as in those examples, but all node
+ *	access goes through a ProfiledNodeMap (see Abhi_common/NodeAccessProfiler.h).
+ *	The number of gets, sets and executes per feature, together with total and
+ *	worst-case time, is printed just before each camera is deinitialized.
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <iostream>
+#include <sstream>
+#include "NodeAccessProfiler.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+
+// This function enables chunk mode and every type of chunk data, as in the
+// ChunkData example. The selector and enable nodes are retrieved once and
+// each iteration of the loop is timed separately.
+int ConfigureChunkData(ProfiledNodeMap & nodeMap)
+{
+	int result = 0;
+
+	cout << endl << "*** CONFIGURING CHUNK DATA ***" << endl << endl;
+
+	try
+	{
+		// Activate chunk mode
+		if (!nodeMap.SetBoolean("ChunkModeActive", true))
+		{
+			cout << "Unable to activate chunk mode. Aborting..." << endl << endl;
+			return -1;
+		}
+
+		cout << "Chunk mode activated..." << endl;
+
+		// Retrieve the selector node and its entries
+		NodeList_t entries;
+		CEnumerationPtr ptrChunkSelector;
+
+		{
+			NodeAccessTimer timer(nodeMap.GetProfiler(), "ChunkSelector", NODE_GET);
+
+			ptrChunkSelector = nodeMap.GetNodeMap().GetNode("ChunkSelector");
+			if (!IsAvailable(ptrChunkSelector) || !IsReadable(ptrChunkSelector))
+			{
+				cout << "Unable to retrieve chunk selector. Aborting..." << endl << endl;
+				return -1;
+			}
+
+			ptrChunkSelector->GetEntries(entries);
+		}
+
+		// Enable each entry
+		int enabledCount = 0;
+
+		for (unsigned int i = 0; i < entries.size(); i++)
+		{
+			CEnumEntryPtr ptrChunkSelectorEntry = entries.at(i);
+
+			if (!IsAvailable(ptrChunkSelectorEntry) || !IsReadable(ptrChunkSelectorEntry))
+			{
+				continue;
+			}
+
+			{
+				NodeAccessTimer timer(nodeMap.GetProfiler(), "ChunkSelector", NODE_SET);
+				ptrChunkSelector->SetIntValue(ptrChunkSelectorEntry->GetValue());
+			}
+
+			bool chunkEnabled = false;
+			if (!nodeMap.GetBoolean("ChunkEnable", chunkEnabled))
+			{
+				continue;
+			}
+
+			if (chunkEnabled || nodeMap.SetBoolean("ChunkEnable", true))
+			{
+				enabledCount++;
+			}
+		}
+
+		cout << enabledCount << " of " << entries.size() << " chunk entries enabled..." << endl;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function disables chunk mode again.
+int ResetChunkData(ProfiledNodeMap & nodeMap)
+{
+	int result = 0;
+
+	try
+	{
+		if (!nodeMap.SetBoolean("ChunkModeActive", false))
+		{
+			cout << "Unable to deactivate chunk mode. Non-fatal error..." << endl << endl;
+			return -1;
+		}
+
+		cout << "Chunk mode deactivated..." << endl;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function configures lookup table 1 linearly, as in the LookupTable
+// example. Every index/value write is recorded against its own feature.
+int ConfigureLookupTables(ProfiledNodeMap & nodeMap)
+{
+	int result = 0;
+
+	cout << endl << "*** CONFIGURING LOOKUP TABLES ***" << endl << endl;
+
+	try
+	{
+		// Select lookup table type
+		if (!nodeMap.SetEnumeration("LUTSelector", "LUT1"))
+		{
+			cout << "Unable to select lookup table. Aborting..." << endl << endl;
+			return -1;
+		}
+
+		cout << "Lookup table selector set to LUT 1..." << endl;
+
+		// Retrieve value and index nodes and the maximum range
+		CIntegerPtr ptrLUTValue;
+		CIntegerPtr ptrLUTIndex;
+		int maxRange = 0;
+
+		{
+			NodeAccessTimer timer(nodeMap.GetProfiler(), "LUTValue", NODE_GET);
+
+			ptrLUTValue = nodeMap.GetNodeMap().GetNode("LUTValue");
+			if (!IsAvailable(ptrLUTValue) || !IsReadable(ptrLUTValue))
+			{
+				cout << "Unable to set lookup table value (node retrieval). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			maxRange = (int)ptrLUTValue->GetMax() + 1;
+		}
+
+		ptrLUTIndex = nodeMap.GetNodeMap().GetNode("LUTIndex");
+		if (!IsAvailable(ptrLUTIndex) || !IsReadable(ptrLUTIndex))
+		{
+			cout << "Unable to set lookup table index (node retrieval). Aborting..." << endl << endl;
+			return -1;
+		}
+
+		int increment = maxRange / 512;
+		if (increment < 1)
+		{
+			increment = 1;
+		}
+
+		// Set values and indexes
+		for (int i = 0; i < maxRange; i += increment)
+		{
+			{
+				NodeAccessTimer timer(nodeMap.GetProfiler(), "LUTIndex", NODE_SET);
+				ptrLUTIndex->SetValue(i);
+			}
+			{
+				NodeAccessTimer timer(nodeMap.GetProfiler(), "LUTValue", NODE_SET);
+				ptrLUTValue->SetValue(i);
+			}
+		}
+
+		cout << "All lookup table values set..." << endl;
+
+		// Enable lookup tables
+		if (!nodeMap.SetBoolean("LUTEnable", true))
+		{
+			cout << "Unable to enable lookup tables. Aborting..." << endl << endl;
+			return -1;
+		}
+
+		cout << "Lookup tables enabled..." << endl;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function resets the camera by disabling lookup tables.
+int ResetLookupTables(ProfiledNodeMap & nodeMap)
+{
+	int result = 0;
+
+	try
+	{
+		if (!nodeMap.SetBoolean("LUTEnable", false))
+		{
+			cout << "Unable to disable lookup tables. Non-fatal error..." << endl << endl;
+			return -1;
+		}
+
+		cout << "Lookup tables disabled..." << endl;
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function runs the profiled configuration steps on one camera and prints
+// the report before the camera is deinitialized.
+int RunSingleCamera(CameraPtr pCam, unsigned int camNum)
+{
+	int result = 0;
+
+	try
+	{
+		// Retrieve serial number to label the report
+		string deviceSerialNumber = "";
+
+		CStringPtr ptrStringSerial = pCam->GetTLDeviceNodeMap().GetNode("DeviceSerialNumber");
+		if (IsAvailable(ptrStringSerial) && IsReadable(ptrStringSerial))
+		{
+			deviceSerialNumber = ptrStringSerial->GetValue();
+		}
+
+		ostringstream label;
+		label << "camera " << camNum;
+		if (deviceSerialNumber != "")
+		{
+			label << ", serial " << deviceSerialNumber;
+		}
+
+		NodeAccessProfiler profiler(label.str());
+
+		// Initialize camera
+		pCam->Init();
+
+		ProfiledNodeMap nodeMap(pCam->GetNodeMap(), profiler);
+
+		// Run the configuration steps and undo them again
+		int err = ConfigureChunkData(nodeMap);
+		if (err == 0)
+		{
+			result = result | ResetChunkData(nodeMap);
+		}
+		result = result | err;
+
+		err = ConfigureLookupTables(nodeMap);
+		if (err == 0)
+		{
+			result = result | ResetLookupTables(nodeMap);
+		}
+		result = result | err;
+
+		// Print report and deinitialize camera
+		profiler.PrintReport();
+
+		pCam->DeInit();
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// Example entry point; please see Enumeration example for more in-depth
+// comments on preparing and cleaning up the system.
+int main(int /*argc*/, char** /*argv*/)
+{
+	int result = 0;
+
+	// Retrieve singleton reference to system object
+	SystemPtr system = System::GetInstance();
+
+	// Retrieve list of cameras from the system
+	CameraList camList = system->GetCameras();
+
+	unsigned int numCameras = camList.GetSize();
+
+	cout << "Number of cameras detected: " << numCameras << endl << endl;
+
+	// Finish if there are no cameras
+	if (numCameras == 0)
+	{
+		// Clear camera list before releasing system
+		camList.Clear();
+
+		// Release system
+		system->ReleaseInstance();
+
+		cout << "Not enough cameras!" << endl;
+		cout << "Done! Press Enter to exit..." << endl;
+		getchar();
+
+		return -1;
+	}
+
+	// Run example on each camera
+	for (unsigned int i = 0; i < numCameras; i++)
+	{
+		cout << endl << "Running example for camera " << i << "..." << endl;
+
+		result = result | RunSingleCamera(camList.GetByIndex(i), i);
+
+		cout << "Camera " << i << " example complete..." << endl << endl;
+	}
+
+	// Clear camera list before releasing system
+	camList.Clear();
+
+	// Release system
+	system->ReleaseInstance();
+
+	cout << endl << "Done! Press Enter to exit..." << endl;
+	getchar();
+
+	return result;
+}
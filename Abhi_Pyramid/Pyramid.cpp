@@ -0,0 +1,351 @@
+/**
+ *	@example Pyramid.cpp
+ *
+ *	@brief Pyramid.cpp shows the preview and writes thumbnails of all
+ *	cameras from one pyramid pass per frame (see Abhi_common/FramePyramid.h),
+ *	where Abhi_test2 runs a full-frame cv::resize() per output size.
+ *
+ *	Each level of the pyramid goes to its own consumer: the first level at
+ *	least k_previewWidth wide is resized the last bit to 640x480 and shown,
+ *	and the first level at least k_thumbnailWidth wide is saved as
+ *	thumbnails/Cam-<n>.jpg every k_thumbnailInterval frames for the web UI.
+ *	Press q to quit.
+ *
+ *	With -b no camera is needed: synthetic Mono8 and BGR8 frames are reduced
+ *	to the same outputs by a pyramid and by one cv::resize() per output, and
+ *	the time per frame of both is printed.
+ *
+ *	Usage: Pyramid [-b [frames]]
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/opencv.hpp>
+#include "FramePyramid.h"
+#include "SyntheticCamera.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+using namespace cv;
+
+// Downscaled levels built per frame: 1/2 down to 1/16
+const unsigned int k_numLevels = 4;
+
+// Preview window size, as in Abhi_test2
+const int k_previewWidth = 640;
+const int k_previewHeight = 480;
+
+// Thumbnails for the web UI
+const unsigned int k_thumbnailWidth = 160;
+const unsigned int k_thumbnailInterval = 30;
+const char* k_thumbnailDirectory = "thumbnails";
+
+// Frames per benchmark case
+const unsigned int k_defaultBenchFrames = 200;
+
+// This helper returns the smallest level that is at least minWidth wide.
+unsigned int SelectLevel(unsigned int width, unsigned int minWidth)
+{
+	unsigned int level = 0;
+	while (level < k_numLevels && width / 2 >= minWidth)
+	{
+		width /= 2;
+		level++;
+	}
+	return level;
+}
+
+// This helper wraps a pyramid level in a cv::Mat without copying.
+Mat LevelToMat(const PyramidLevel & level)
+{
+	return cv::Mat(static_cast<int>(level.height), static_cast<int>(level.width),
+		level.channels == 1 ? CV_8UC1 : CV_8UC3, const_cast<uint8_t*>(level.data), level.stride);
+}
+
+// This function shows the preview and writes thumbnails of all cameras
+// until q is pressed.
+int AcquireImages(CameraList camList)
+{
+	int result = 0;
+	CameraPtr pCam = NULL;
+
+	cout << endl << "*** PYRAMID PREVIEW ***" << endl << endl;
+
+	try
+	{
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			CEnumerationPtr ptrAcquisitionMode = pCam->GetNodeMap().GetNode("AcquisitionMode");
+			if (!IsAvailable(ptrAcquisitionMode) || !IsWritable(ptrAcquisitionMode))
+			{
+				cout << "Unable to set acquisition mode to continuous (node retrieval; camera " << i << "). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			CEnumEntryPtr ptrAcquisitionModeContinuous = ptrAcquisitionMode->GetEntryByName("Continuous");
+			if (!IsAvailable(ptrAcquisitionModeContinuous) || !IsReadable(ptrAcquisitionModeContinuous))
+			{
+				cout << "Unable to set acquisition mode to continuous (entry 'continuous' retrieval " << i << "). Aborting..." << endl << endl;
+				return -1;
+			}
+
+			ptrAcquisitionMode->SetIntValue(ptrAcquisitionModeContinuous->GetValue());
+
+			pCam->BeginAcquisition();
+
+			cout << "Camera " << i << " started acquiring images..." << endl;
+		}
+
+		mkdir(k_thumbnailDirectory, 0755);
+
+		// One pyramid per camera; its consumers know their camera
+		vector<FramePyramid*> pyramids;
+		vector<unsigned int> frameCounts(camList.GetSize(), 0);
+		vector<double> passMs(camList.GetSize(), 0.0);
+
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pyramids.push_back(new FramePyramid(k_numLevels));
+		}
+
+		char key = 0;
+		string label = "Cam";
+
+		while (key != 'q' && result == 0)
+		{
+			for (unsigned int i = 0; i < camList.GetSize(); i++)
+			{
+				try
+				{
+					pCam = camList.GetByIndex(i);
+
+					ImagePtr pResultImage = pCam->GetNextImage();
+
+					if (pResultImage->IsIncomplete())
+					{
+						cout << "Image incomplete with image status " << pResultImage->GetImageStatus() << "..." << endl << endl;
+					}
+					else
+					{
+						ImagePtr convertedImage = pResultImage->Convert(PixelFormat_Mono8, HQ_LINEAR);
+
+						const unsigned int width = static_cast<unsigned int>(convertedImage->GetWidth());
+						const unsigned int previewLevel = SelectLevel(width, k_previewWidth);
+						const unsigned int thumbnailLevel = SelectLevel(width, k_thumbnailWidth);
+						const unsigned int frameCount = frameCounts[i]++;
+
+						pyramids[i]->SetConsumer(previewLevel, [&](const PyramidLevel & level)
+						{
+							Mat preview;
+							cv::resize(LevelToMat(level), preview, Size(k_previewWidth, k_previewHeight), 0, 0, INTER_LINEAR);
+							cv::imshow(label + to_string(i), preview);
+						});
+
+						if (thumbnailLevel != previewLevel)
+						{
+							pyramids[i]->SetConsumer(thumbnailLevel, [&](const PyramidLevel & level)
+							{
+								if (frameCount % k_thumbnailInterval == 0)
+								{
+									ostringstream filename;
+									filename << k_thumbnailDirectory << "/Cam-" << i << ".jpg";
+									cv::imwrite(filename.str(), LevelToMat(level));
+								}
+							});
+						}
+
+						chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+						pyramids[i]->Build(static_cast<const uint8_t*>(convertedImage->GetData()), width,
+							static_cast<unsigned int>(convertedImage->GetHeight()), convertedImage->GetStride());
+
+						passMs[i] += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+						key = cv::waitKey(2);
+					}
+
+					pResultImage->Release();
+				}
+				catch (Spinnaker::Exception &e)
+				{
+					cout << "Error: " << e.what() << endl;
+					result = -1;
+				}
+			}
+		}
+
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+			pCam->EndAcquisition();
+
+			if (frameCounts[i] > 0)
+			{
+				cout << "Camera " << i << ": " << frameCounts[i] << " frames, " << passMs[i] / frameCounts[i]
+					<< " ms per pyramid pass including consumers" << endl;
+			}
+
+			delete pyramids[i];
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function times one benchmark case: the pyramid against a separate
+// cv::resize() per output level.
+void BenchmarkCase(const char* name, const Mat & frame, unsigned int numFrames)
+{
+	const unsigned int channels = frame.channels();
+
+	FramePyramid pyramid(k_numLevels, channels);
+	vector<Mat> outputs(k_numLevels);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	for (unsigned int n = 0; n < numFrames; n++)
+	{
+		pyramid.Build(frame.ptr(), frame.cols, frame.rows, frame.step);
+	}
+
+	const double pyramidMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / numFrames;
+
+	start = chrono::steady_clock::now();
+
+	for (unsigned int n = 0; n < numFrames; n++)
+	{
+		for (unsigned int level = 1; level <= k_numLevels; level++)
+		{
+			cv::resize(frame, outputs[level - 1], Size(frame.cols >> level, frame.rows >> level), 0, 0, INTER_AREA);
+		}
+	}
+
+	const double resizeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / numFrames;
+
+	cout << name << ": pyramid " << pyramidMs << " ms, " << k_numLevels << " x cv::resize " << resizeMs
+		<< " ms per frame (" << resizeMs / pyramidMs << "x)" << endl;
+}
+
+// This function runs the benchmark on synthetic 1280x1024 frames.
+int RunBenchmark(unsigned int numFrames)
+{
+	cout << endl << "*** PYRAMID BENCHMARK ***" << endl << endl;
+
+	SyntheticCamera camera(1280, 1024, SYNTHETIC_BAYER_RG8);
+	const uint8_t* raw = camera.NextFrame();
+
+	Mat bayer = cv::Mat(camera.GetHeight(), camera.GetWidth(), CV_8UC1, const_cast<uint8_t*>(raw), camera.GetStride());
+	Mat mono;
+	Mat colour;
+	cv::cvtColor(bayer, mono, COLOR_BayerBG2GRAY);
+	cv::cvtColor(bayer, colour, COLOR_BayerBG2BGR);
+
+	BenchmarkCase("Mono8 1280x1024", mono, numFrames);
+	BenchmarkCase("BGR8 1280x1024", colour, numFrames);
+
+	return 0;
+}
+
+// This function takes care of initializing and deinitializing cameras.
+int RunMultipleCameras(CameraList camList)
+{
+	int result = 0;
+	CameraPtr pCam = NULL;
+
+	try
+	{
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			pCam->Init();
+		}
+
+		result = result | AcquireImages(camList);
+
+		for (unsigned int i = 0; i < camList.GetSize(); i++)
+		{
+			pCam = camList.GetByIndex(i);
+
+			pCam->DeInit();
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// Example entry point; please see Enumeration example for more in-depth
+// comments on preparing and cleaning up the system.
+int main(int argc, char** argv)
+{
+	int result = 0;
+
+	if (argc >= 2 && strcmp(argv[1], "-b") == 0)
+	{
+		return RunBenchmark(argc >= 3 ? static_cast<unsigned int>(atoi(argv[2])) : k_defaultBenchFrames);
+	}
+
+	// Retrieve singleton reference to system object
+	SystemPtr system = System::GetInstance();
+
+	// Retrieve list of cameras from the system
+	CameraList camList = system->GetCameras();
+
+	unsigned int numCameras = camList.GetSize();
+
+	cout << "Number of cameras detected: " << numCameras << endl << endl;
+
+	// Finish if there are no cameras
+	if (numCameras == 0)
+	{
+		// Clear camera list before releasing system
+		camList.Clear();
+
+		// Release system
+		system->ReleaseInstance();
+
+		cout << "Not enough cameras!" << endl;
+		cout << "Done! Press Enter to exit..." << endl;
+		getchar();
+
+		return -1;
+	}
+
+	result = RunMultipleCameras(camList);
+
+	// Clear camera list before releasing system
+	camList.Clear();
+
+	// Release system
+	system->ReleaseInstance();
+
+	cout << endl << "Done! Press Enter to exit..." << endl;
+	getchar();
+
+	return result;
+}
@@ -0,0 +1,274 @@
+/**
+ *	@example SensorModes.cpp
+ *
+ *	@brief SensorModes.cpp compares grabbing full frames and resizing them on
+ *	the host (as Abhi_test2 and MultiCamStream do) with letting the sensor bin
+ *	or decimate the image. It relies on information provided in the
+ *	Acquisition and ImageFormatControl examples.
+ *
+ *	The camera is switched between a full-quality and a high-speed mode while
+ *	streaming, using ApplySensorMode() from Abhi_common/SensorModes.h. For each
+ *	mode a fixed number of frames is grabbed, converted to mono 8 and brought to
+ *	preview size. The example prints the resulting frame rate reported by the
+ *	camera, the measured frame rate, the host CPU time per frame and how much
+ *	CPU the high-speed mode saves.
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <sys/resource.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/opencv.hpp>
+#include "SensorModes.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+using namespace cv;
+
+// Frames grabbed per mode
+const unsigned int k_numImages = 200;
+
+// Preview size the display path expects
+const int k_previewWidth = 640;
+const int k_previewHeight = 480;
+
+// Binning/decimation factor of the high-speed mode
+const int64_t k_highSpeedFactor = 2;
+
+// Measured cost of one mode
+struct ModeMeasurement
+{
+	double framesPerSecond;
+	double cpuMsPerFrame;
+	unsigned int numIncomplete;
+};
+
+// This helper returns user plus system CPU time of the process in milliseconds.
+double GetProcessCpuMs()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+		(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+// This function grabs k_numImages frames and brings each to preview size, the
+// same work the display path does per frame.
+int MeasureMode(CameraPtr pCam, ModeMeasurement & measurement)
+{
+	int result = 0;
+
+	measurement.numIncomplete = 0;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	double cpuStartMs = GetProcessCpuMs();
+
+	for (unsigned int imageCnt = 0; imageCnt < k_numImages; imageCnt++)
+	{
+		try
+		{
+			ImagePtr pResultImage = pCam->GetNextImage();
+
+			if (pResultImage->IsIncomplete())
+			{
+				measurement.numIncomplete++;
+			}
+			else
+			{
+				ImagePtr convertedImage = pResultImage->Convert(PixelFormat_Mono8, HQ_LINEAR);
+
+				unsigned int rowBytes = (int)convertedImage->GetImageSize() / convertedImage->GetHeight();
+
+				Mat image = cv::Mat(convertedImage->GetHeight(), convertedImage->GetWidth(), CV_8UC1,
+					convertedImage->GetData(), rowBytes);
+
+				Mat preview;
+				if (image.cols != k_previewWidth || image.rows != k_previewHeight)
+				{
+					cv::resize(image, preview, Size(k_previewWidth, k_previewHeight), 0, 0, INTER_LINEAR);
+				}
+			}
+
+			pResultImage->Release();
+		}
+		catch (Spinnaker::Exception &e)
+		{
+			cout << "Error: " << e.what() << endl;
+			result = -1;
+		}
+	}
+
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	measurement.framesPerSecond = k_numImages / elapsed.count();
+	measurement.cpuMsPerFrame = (GetProcessCpuMs() - cpuStartMs) / k_numImages;
+
+	return result;
+}
+
+// This function switches to a mode, prints what the switch cost, and measures
+// the mode.
+int RunMode(CameraPtr pCam, const SensorMode & mode, ModeMeasurement & measurement)
+{
+	SensorModeReport report;
+
+	if (ApplySensorMode(pCam, mode, report) != 0)
+	{
+		return -1;
+	}
+
+	cout << "Mode " << mode.name << ": " << report.width << "x" << report.height
+		<< ", " << report.nodesWritten << " nodes written in " << report.switchMs << " ms"
+		<< (report.restarted ? " (acquisition restarted)" : " (no restart)") << endl;
+	cout << "\tResulting frame rate reported by camera: " << report.resultingFrameRate << " fps" << endl;
+
+	int result = MeasureMode(pCam, measurement);
+
+	cout << "\tMeasured: " << measurement.framesPerSecond << " fps, "
+		<< measurement.cpuMsPerFrame << " ms host CPU per frame, "
+		<< measurement.numIncomplete << " incomplete" << endl << endl;
+
+	return result;
+}
+
+// This function acts as the body of the example; please see NodeMapInfo example
+// for more in-depth comments on setting up cameras.
+int RunSingleCamera(CameraPtr pCam)
+{
+	int result = 0;
+
+	try
+	{
+		// Initialize camera
+		pCam->Init();
+
+		INodeMap & nodeMap = pCam->GetNodeMap();
+
+		// Set acquisition mode to continuous
+		CEnumerationPtr ptrAcquisitionMode = nodeMap.GetNode("AcquisitionMode");
+		if (!IsAvailable(ptrAcquisitionMode) || !IsWritable(ptrAcquisitionMode))
+		{
+			cout << "Unable to set acquisition mode to continuous (enum retrieval). Aborting..." << endl << endl;
+			pCam->DeInit();
+			return -1;
+		}
+
+		CEnumEntryPtr ptrAcquisitionModeContinuous = ptrAcquisitionMode->GetEntryByName("Continuous");
+		if (!IsAvailable(ptrAcquisitionModeContinuous) || !IsReadable(ptrAcquisitionModeContinuous))
+		{
+			cout << "Unable to set acquisition mode to continuous (entry retrieval). Aborting..." << endl << endl;
+			pCam->DeInit();
+			return -1;
+		}
+
+		ptrAcquisitionMode->SetIntValue(ptrAcquisitionModeContinuous->GetValue());
+
+		cout << endl << "*** SENSOR MODES ***" << endl << endl;
+
+		// Start in full quality
+		SensorModeReport report;
+		result = result | ApplySensorMode(pCam, FullQualityMode(), report);
+
+		pCam->BeginAcquisition();
+
+		ModeMeasurement fullQuality;
+		ModeMeasurement highSpeed;
+
+		result = result | RunMode(pCam, FullQualityMode(), fullQuality);
+
+		// Prefer binning; fall back to decimation on sensors without it
+		SensorMode highSpeedMode = HighSpeedBinnedMode(k_highSpeedFactor);
+
+		CIntegerPtr ptrBinning = nodeMap.GetNode("BinningHorizontal");
+		if (!IsAvailable(ptrBinning) || ptrBinning->GetMax() < k_highSpeedFactor)
+		{
+			highSpeedMode = HighSpeedDecimatedMode(k_highSpeedFactor);
+		}
+
+		result = result | RunMode(pCam, highSpeedMode, highSpeed);
+
+		// Switch back to confirm the round trip
+		result = result | ApplySensorMode(pCam, FullQualityMode(), report);
+
+		cout << "Switched back to " << FullQualityMode().name << " in " << report.switchMs << " ms" << endl << endl;
+
+		pCam->EndAcquisition();
+
+		// Summary
+		if (fullQuality.cpuMsPerFrame > 0.0)
+		{
+			cout << "Frame rate gain: " << highSpeed.framesPerSecond / fullQuality.framesPerSecond << "x" << endl;
+			cout << "Host CPU saved: "
+				<< 100.0 * (1.0 - highSpeed.cpuMsPerFrame / fullQuality.cpuMsPerFrame) << "% per frame" << endl << endl;
+		}
+
+		// Deinitialize camera
+		pCam->DeInit();
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// Example entry point; please see Enumeration example for more in-depth
+// comments on preparing and cleaning up the system.
+int main(int /*argc*/, char** /*argv*/)
+{
+	int result = 0;
+
+	// Retrieve singleton reference to system object
+	SystemPtr system = System::GetInstance();
+
+	// Retrieve list of cameras from the system
+	CameraList camList = system->GetCameras();
+
+	unsigned int numCameras = camList.GetSize();
+
+	cout << "Number of cameras detected: " << numCameras << endl << endl;
+
+	// Finish if there are no cameras
+	if (numCameras == 0)
+	{
+		// Clear camera list before releasing system
+		camList.Clear();
+
+		// Release system
+		system->ReleaseInstance();
+
+		cout << "Not enough cameras!" << endl;
+		cout << "Done! Press Enter to exit..." << endl;
+		getchar();
+
+		return -1;
+	}
+
+	// Run example on the first camera
+	CameraPtr pCam = camList.GetByIndex(0);
+
+	result = RunSingleCamera(pCam);
+
+	// Release reference to the camera before releasing the system
+	pCam = NULL;
+
+	// Clear camera list before releasing system
+	camList.Clear();
+
+	// Release system
+	system->ReleaseInstance();
+
+	cout << endl << "Done! Press Enter to exit..." << endl;
+	getchar();
+
+	return result;
+}
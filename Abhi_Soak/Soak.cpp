@@ -0,0 +1,570 @@
+/**
+ *	@example Soak.cpp
+ *
+ *	@brief Soak.cpp runs the full frame pipeline against simulated cameras for
+ *	a long time and checks that it stays healthy. Problems such as slow memory
+ *	growth, leaked file descriptors or queues that fill up only show after
+ *	hours, which short tests and the FPS printouts do not catch.
+ *
+ *	Each simulated camera (see Abhi_common/SyntheticCamera.h) produces frames
+ *	at a fixed rate into a fixed set of buffers, like a real camera's buffer
+ *	pool. A consumer thread per camera takes frames from a BoundedQueue,
+ *	converts them to BGR8 with Spinnaker, resizes, JPEG-encodes and
+ *	optionally writes them. A frame is dropped when no buffer is free or the
+ *	queue is full.
+ *
+ *	Every sample interval the harness records resident memory, open file
+ *	descriptors, threads, CPU, queue depths, latency from capture to the end
+ *	of processing (p50/p99) and drops, prints them and appends them to a CSV
+ *	file. At the end the trends after a warm-up period are checked against
+ *	the thresholds below, and the program exits with a nonzero status if any
+ *	is exceeded.
+ *
+ *	Usage: Soak [-d seconds] [-c cameras] [-f fps] [-i sample-seconds]
+ *		[-o samples.csv] [-w write-directory]
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/opencv.hpp>
+#include "SyntheticCamera.h"
+#include "BoundedQueue.h"
+#include "ProcessStats.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+using namespace cv;
+
+// Defaults of the command line options
+const unsigned int k_defaultDurationSeconds = 3600;
+const unsigned int k_defaultNumCameras = 4;
+const double k_defaultFrameRate = 30.0;
+const unsigned int k_defaultSampleSeconds = 10;
+
+// Simulated sensor and processing
+const unsigned int k_width = 1280;
+const unsigned int k_height = 1024;
+const int k_previewWidth = 640;
+const int k_previewHeight = 480;
+const int k_jpegQuality = 90;
+const unsigned int k_numWriteFiles = 8;
+
+// Buffers per camera and frames the queue may hold
+const unsigned int k_numBuffers = 16;
+const unsigned int k_queueCapacity = 8;
+
+// Share of the samples ignored at the start while caches and pools fill
+const double k_warmupFraction = 0.1;
+
+// Trend thresholds
+const double k_maxRssGrowthMbPerHour = 16.0;
+const unsigned int k_maxFdGrowth = 2;
+const double k_maxQueueDepthGrowth = 2.0;
+const double k_maxP99GrowthMsPerHour = 10.0;
+const double k_maxDropPercent = 1.0;
+
+// A frame on its way from producer to consumer
+struct SoakFrame
+{
+	vector<uint8_t>* buffer;
+	uint64_t frameId;
+	chrono::steady_clock::time_point captureTime;
+};
+
+// State of one simulated camera and its pipeline
+struct SoakCamera
+{
+	SoakCamera(unsigned int number)
+		: camera(k_width, k_height, SYNTHETIC_BAYER_RG8, number + 1), camNum(number),
+		freeBuffers(k_numBuffers), frames(k_queueCapacity), numProduced(0), numDropped(0), numProcessed(0), numFailed(0)
+	{
+		buffers.assign(k_numBuffers, vector<uint8_t>(camera.GetImageSize()));
+		for (unsigned int i = 0; i < k_numBuffers; i++)
+		{
+			freeBuffers.TryPush(&buffers[i]);
+		}
+	}
+
+	SyntheticCamera camera;
+	unsigned int camNum;
+
+	vector<vector<uint8_t> > buffers;
+	BoundedQueue<vector<uint8_t>*> freeBuffers;
+	BoundedQueue<SoakFrame> frames;
+
+	atomic<unsigned long long> numProduced;
+	atomic<unsigned long long> numDropped;
+	atomic<unsigned long long> numProcessed;
+	atomic<unsigned long long> numFailed;
+
+	// Latencies since the last sample, in ms
+	mutex latencyMutex;
+	vector<double> latenciesMs;
+};
+
+// One row of the time series
+struct SoakSample
+{
+	double elapsedSeconds;
+	double residentMb;
+	unsigned int openFileDescriptors;
+	unsigned int numThreads;
+	double cpuPercent;
+	unsigned int queueDepth;
+	unsigned int queueHighWaterMark;
+	unsigned long long numProcessed;
+	unsigned long long numDropped;
+	double latencyP50Ms;
+	double latencyP99Ms;
+};
+
+atomic<bool> g_stop(false);
+
+// This function produces frames at the given rate until stopped.
+void ProduceFrames(SoakCamera & cam, double frameRate)
+{
+	const chrono::steady_clock::duration period =
+		chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / frameRate));
+
+	chrono::steady_clock::time_point nextFrame = chrono::steady_clock::now();
+
+	while (!g_stop)
+	{
+		this_thread::sleep_until(nextFrame);
+		nextFrame += period;
+
+		cam.numProduced++;
+
+		vector<uint8_t>* buffer = NULL;
+		if (!cam.freeBuffers.TryPop(buffer))
+		{
+			cam.numDropped++;
+			continue;
+		}
+
+		SoakFrame frame;
+		frame.buffer = buffer;
+		frame.frameId = cam.camera.GetFrameId();
+		frame.captureTime = chrono::steady_clock::now();
+
+		memcpy(&(*buffer)[0], cam.camera.NextFrame(), buffer->size());
+
+		if (!cam.frames.TryPush(frame))
+		{
+			cam.freeBuffers.TryPush(buffer);
+			cam.numDropped++;
+		}
+	}
+}
+
+// This function processes one frame the way the display/record path does.
+void ProcessFrame(const SoakFrame & frame, unsigned int camNum, const string & writeDir, vector<uchar> & encoded)
+{
+	ImagePtr rawImage = Image::Create(k_width, k_height, 0, 0, PixelFormat_BayerRG8, &(*frame.buffer)[0]);
+	ImagePtr convertedImage = rawImage->Convert(PixelFormat_BGR8, HQ_LINEAR);
+
+	Mat image = cv::Mat(convertedImage->GetHeight(), convertedImage->GetWidth(), CV_8UC3,
+		convertedImage->GetData(), convertedImage->GetImageSize() / convertedImage->GetHeight());
+
+	Mat preview;
+	cv::resize(image, preview, Size(k_previewWidth, k_previewHeight), 0, 0, INTER_LINEAR);
+
+	vector<int> params;
+	params.push_back(IMWRITE_JPEG_QUALITY);
+	params.push_back(k_jpegQuality);
+
+	cv::imencode(".jpg", preview, encoded, params);
+
+	if (!writeDir.empty() && !encoded.empty())
+	{
+		ostringstream path;
+		path << writeDir << "/cam" << camNum << "_" << frame.frameId % k_numWriteFiles << ".jpg";
+
+		FILE* file = fopen(path.str().c_str(), "wb");
+		if (file != NULL)
+		{
+			fwrite(&encoded[0], 1, encoded.size(), file);
+			fclose(file);
+		}
+	}
+}
+
+// This function consumes frames until stopped and the queue is drained.
+void ConsumeFrames(SoakCamera & cam, const string & writeDir)
+{
+	vector<uchar> encoded;
+
+	while (true)
+	{
+		SoakFrame frame;
+		if (!cam.frames.Pop(frame, 100))
+		{
+			if (g_stop)
+			{
+				break;
+			}
+			continue;
+		}
+
+		try
+		{
+			ProcessFrame(frame, cam.camNum, writeDir, encoded);
+			cam.numProcessed++;
+		}
+		catch (Spinnaker::Exception &e)
+		{
+			cout << "Error: " << e.what() << endl;
+			cam.numFailed++;
+		}
+
+		cam.freeBuffers.TryPush(frame.buffer);
+
+		chrono::duration<double, milli> latency = chrono::steady_clock::now() - frame.captureTime;
+
+		lock_guard<mutex> lock(cam.latencyMutex);
+		cam.latenciesMs.push_back(latency.count());
+	}
+}
+
+// This helper returns the given percentile of a sorted list.
+double GetPercentile(const vector<double> & sorted, double percentile)
+{
+	if (sorted.empty())
+	{
+		return 0.0;
+	}
+
+	size_t index = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+	return sorted[min(index, sorted.size() - 1)];
+}
+
+// This function takes one sample of the process and all pipelines.
+SoakSample TakeSample(vector<SoakCamera*> & cameras, double elapsedSeconds, double lastElapsedSeconds, double & lastCpuMs)
+{
+	SoakSample sample;
+	ProcessStats stats = SampleProcessStats();
+
+	sample.elapsedSeconds = elapsedSeconds;
+	sample.residentMb = stats.residentBytes / (1024.0 * 1024.0);
+	sample.openFileDescriptors = stats.openFileDescriptors;
+	sample.numThreads = stats.numThreads;
+	sample.cpuPercent = elapsedSeconds > lastElapsedSeconds ?
+		100.0 * (stats.cpuMs - lastCpuMs) / (1000.0 * (elapsedSeconds - lastElapsedSeconds)) : 0.0;
+	lastCpuMs = stats.cpuMs;
+
+	sample.queueDepth = 0;
+	sample.queueHighWaterMark = 0;
+	sample.numProcessed = 0;
+	sample.numDropped = 0;
+
+	vector<double> latenciesMs;
+
+	for (size_t i = 0; i < cameras.size(); i++)
+	{
+		sample.queueDepth += static_cast<unsigned int>(cameras[i]->frames.Size());
+		sample.queueHighWaterMark = max(sample.queueHighWaterMark, static_cast<unsigned int>(cameras[i]->frames.GetHighWaterMark()));
+		cameras[i]->frames.ResetHighWaterMark();
+
+		sample.numProcessed += cameras[i]->numProcessed;
+		sample.numDropped += cameras[i]->numDropped;
+
+		// Take the latencies and leave an empty list with the same capacity,
+		// so the list does not grow over the run
+		lock_guard<mutex> lock(cameras[i]->latencyMutex);
+		latenciesMs.insert(latenciesMs.end(), cameras[i]->latenciesMs.begin(), cameras[i]->latenciesMs.end());
+		cameras[i]->latenciesMs.clear();
+	}
+
+	sort(latenciesMs.begin(), latenciesMs.end());
+	sample.latencyP50Ms = GetPercentile(latenciesMs, 50.0);
+	sample.latencyP99Ms = GetPercentile(latenciesMs, 99.0);
+
+	return sample;
+}
+
+// This function prints one sample.
+void PrintSample(const SoakSample & sample)
+{
+	cout << "[" << static_cast<unsigned int>(sample.elapsedSeconds) << " s] RSS " << sample.residentMb << " MB, "
+		<< sample.openFileDescriptors << " fds, " << sample.numThreads << " threads, CPU " << sample.cpuPercent << "%, queue "
+		<< sample.queueDepth << " (max " << sample.queueHighWaterMark << "), processed " << sample.numProcessed
+		<< ", dropped " << sample.numDropped << ", latency p50 " << sample.latencyP50Ms << " ms p99 "
+		<< sample.latencyP99Ms << " ms" << endl;
+}
+
+// This function writes one sample as a CSV row.
+void WriteSample(ofstream & csv, const SoakSample & sample)
+{
+	csv << sample.elapsedSeconds << "," << sample.residentMb << "," << sample.openFileDescriptors << ","
+		<< sample.numThreads << "," << sample.cpuPercent << "," << sample.queueDepth << ","
+		<< sample.queueHighWaterMark << "," << sample.numProcessed << "," << sample.numDropped << ","
+		<< sample.latencyP50Ms << "," << sample.latencyP99Ms << endl;
+}
+
+// This helper returns the least-squares slope of values over time, per hour.
+double GetSlopePerHour(const vector<double> & seconds, const vector<double> & values)
+{
+	const double n = static_cast<double>(seconds.size());
+	if (n < 2)
+	{
+		return 0.0;
+	}
+
+	double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+	for (size_t i = 0; i < seconds.size(); i++)
+	{
+		const double hours = seconds[i] / 3600.0;
+		sumX += hours;
+		sumY += values[i];
+		sumXX += hours * hours;
+		sumXY += hours * values[i];
+	}
+
+	const double denominator = n * sumXX - sumX * sumX;
+	return denominator > 0.0 ? (n * sumXY - sumX * sumY) / denominator : 0.0;
+}
+
+// This function checks the trends after warm-up against the thresholds.
+// Returns -1 if any is exceeded.
+int CheckTrends(const vector<SoakSample> & samples)
+{
+	size_t first = static_cast<size_t>(samples.size() * k_warmupFraction);
+	first = max(first, static_cast<size_t>(1));
+
+	if (samples.size() < first + 3)
+	{
+		cout << "Not enough samples after warm-up to check trends; run longer or sample more often." << endl;
+		return 0;
+	}
+
+	vector<double> seconds, residentMb, p99Ms;
+	double queueFirstQuarter = 0.0, queueLastQuarter = 0.0;
+	unsigned int fdsAtStart = samples[first].openFileDescriptors;
+	unsigned int fdsMax = fdsAtStart;
+
+	const size_t count = samples.size() - first;
+	const size_t quarter = max(count / 4, static_cast<size_t>(1));
+
+	for (size_t i = first; i < samples.size(); i++)
+	{
+		seconds.push_back(samples[i].elapsedSeconds);
+		residentMb.push_back(samples[i].residentMb);
+		p99Ms.push_back(samples[i].latencyP99Ms);
+		fdsMax = max(fdsMax, samples[i].openFileDescriptors);
+
+		if (i - first < quarter)
+		{
+			queueFirstQuarter += samples[i].queueDepth;
+		}
+		if (samples.size() - i <= quarter)
+		{
+			queueLastQuarter += samples[i].queueDepth;
+		}
+	}
+
+	queueFirstQuarter /= quarter;
+	queueLastQuarter /= quarter;
+
+	const double rssSlope = GetSlopePerHour(seconds, residentMb);
+	const double p99Slope = GetSlopePerHour(seconds, p99Ms);
+
+	const SoakSample & last = samples.back();
+	const double dropPercent = last.numProcessed + last.numDropped > 0 ?
+		100.0 * last.numDropped / (last.numProcessed + last.numDropped) : 0.0;
+
+	int result = 0;
+
+	cout << endl << "*** TRENDS AFTER WARM-UP ***" << endl << endl;
+
+	cout << "RSS growth: " << rssSlope << " MB/hour (limit " << k_maxRssGrowthMbPerHour << ")";
+	if (rssSlope > k_maxRssGrowthMbPerHour)
+	{
+		cout << " FAILED";
+		result = -1;
+	}
+	cout << endl;
+
+	cout << "File descriptor growth: " << fdsMax - fdsAtStart << " (limit " << k_maxFdGrowth << ")";
+	if (fdsMax - fdsAtStart > k_maxFdGrowth)
+	{
+		cout << " FAILED";
+		result = -1;
+	}
+	cout << endl;
+
+	cout << "Queue depth: " << queueFirstQuarter << " -> " << queueLastQuarter << " (limit +" << k_maxQueueDepthGrowth << ")";
+	if (queueLastQuarter - queueFirstQuarter > k_maxQueueDepthGrowth)
+	{
+		cout << " FAILED";
+		result = -1;
+	}
+	cout << endl;
+
+	cout << "p99 latency growth: " << p99Slope << " ms/hour (limit " << k_maxP99GrowthMsPerHour << ")";
+	if (p99Slope > k_maxP99GrowthMsPerHour)
+	{
+		cout << " FAILED";
+		result = -1;
+	}
+	cout << endl;
+
+	cout << "Dropped frames: " << dropPercent << "% (limit " << k_maxDropPercent << "%)";
+	if (dropPercent > k_maxDropPercent)
+	{
+		cout << " FAILED";
+		result = -1;
+	}
+	cout << endl;
+
+	return result;
+}
+
+// Example entry point
+int main(int argc, char** argv)
+{
+	int result = 0;
+
+	unsigned int durationSeconds = k_defaultDurationSeconds;
+	unsigned int numCameras = k_defaultNumCameras;
+	double frameRate = k_defaultFrameRate;
+	unsigned int sampleSeconds = k_defaultSampleSeconds;
+	string csvPath;
+	string writeDir;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-d") == 0)
+		{
+			durationSeconds = static_cast<unsigned int>(atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-c") == 0)
+		{
+			numCameras = static_cast<unsigned int>(atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-f") == 0)
+		{
+			frameRate = atof(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-i") == 0)
+		{
+			sampleSeconds = static_cast<unsigned int>(atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-o") == 0)
+		{
+			csvPath = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "-w") == 0)
+		{
+			writeDir = argv[i + 1];
+		}
+		else
+		{
+			cout << "Unknown option " << argv[i] << ". Aborting..." << endl << endl;
+			return -1;
+		}
+	}
+
+	if (durationSeconds == 0 || numCameras == 0 || frameRate <= 0.0 || sampleSeconds == 0)
+	{
+		cout << "Duration, camera count, frame rate and sample interval must be positive. Aborting..." << endl << endl;
+		return -1;
+	}
+
+	ofstream csv;
+	if (!csvPath.empty())
+	{
+		csv.open(csvPath.c_str());
+		if (!csv.is_open())
+		{
+			cout << "Unable to write samples to " << csvPath << ". Aborting..." << endl << endl;
+			return -1;
+		}
+
+		csv << "elapsed_s,rss_mb,fds,threads,cpu_pct,queue_depth,queue_high_water,processed,dropped,p50_ms,p99_ms" << endl;
+	}
+
+	cout << endl << "*** SOAK TEST ***" << endl << endl;
+	cout << numCameras << " simulated cameras at " << frameRate << " fps for " << durationSeconds << " s" << endl << endl;
+
+	vector<SoakCamera*> cameras;
+	vector<thread> threads;
+
+	for (unsigned int i = 0; i < numCameras; i++)
+	{
+		cameras.push_back(new SoakCamera(i));
+	}
+
+	for (unsigned int i = 0; i < numCameras; i++)
+	{
+		threads.push_back(thread(ConsumeFrames, ref(*cameras[i]), cref(writeDir)));
+		threads.push_back(thread(ProduceFrames, ref(*cameras[i]), frameRate));
+	}
+
+	// Sample until the duration is over
+	vector<SoakSample> samples;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	double lastElapsedSeconds = 0.0;
+	double lastCpuMs = SampleProcessStats().cpuMs;
+
+	for (unsigned int sampleCnt = 1; sampleCnt * sampleSeconds <= durationSeconds; sampleCnt++)
+	{
+		this_thread::sleep_until(start + chrono::seconds(sampleCnt * sampleSeconds));
+
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+		SoakSample sample = TakeSample(cameras, elapsed.count(), lastElapsedSeconds, lastCpuMs);
+		lastElapsedSeconds = elapsed.count();
+
+		PrintSample(sample);
+		if (csv.is_open())
+		{
+			WriteSample(csv, sample);
+		}
+
+		samples.push_back(sample);
+	}
+
+	// Stop producers first, then let consumers drain their queues
+	g_stop = true;
+
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i].join();
+	}
+
+	unsigned long long numFailed = 0;
+	for (unsigned int i = 0; i < numCameras; i++)
+	{
+		numFailed += cameras[i]->numFailed;
+		delete cameras[i];
+	}
+
+	if (numFailed > 0)
+	{
+		cout << numFailed << " frames failed to process" << endl;
+		result = -1;
+	}
+
+	result = result | CheckTrends(samples);
+
+	cout << endl << (result == 0 ? "Soak test passed" : "Soak test FAILED") << endl;
+
+	return result;
+}
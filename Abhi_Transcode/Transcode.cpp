@@ -0,0 +1,438 @@
+/**
+ *	@example Transcode.cpp
+ *
+ *	@brief Transcode.cpp turns a raw journaled recording (see
+ *	Abhi_JournaledRecording) into AVI files like the ones SaveToAvi writes,
+ *	using every core. No camera is needed.
+ *
+ *	The recording is cut into segments of consecutive frames, and worker
+ *	threads take the next unclaimed segment until none are left, so fast and
+ *	slow segments even out over the threads. With the built-in MJPG encoder,
+ *	each worker JPEG-encodes its segment into a temporary segment file, and
+ *	the segments are concatenated into one AVI at the end (see
+ *	Abhi_common/MjpegAviWriter.h). With the AVIRecorder codecs every segment
+ *	becomes an AVI file of its own (<output>-<segment>.avi), because
+ *	AVIRecorder files cannot be joined after AVIClose(); for H264 a segment
+ *	then starts on a fresh GOP.
+ *
+ *	Speed is reported as a multiple of real time: the time span of the
+ *	recording (from the camera timestamps) divided by the time taken.
+ *
+ *	Usage: Transcode input.jrn output [-c mjpg|avi|spin-mjpg|h264]
+ *		[-t threads] [-g frames-per-segment] [-q quality] [-f frame-rate]
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include "AVIRecorder.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/opencv.hpp>
+#include "JournaledRecording.h"
+#include "MjpegAviWriter.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+using namespace cv;
+
+// Output codecs
+enum transcodeCodec
+{
+	CODEC_MJPG,				// built-in encoder, one AVI file
+	CODEC_AVI,				// AVIRecorder, uncompressed
+	CODEC_SPIN_MJPG,		// AVIRecorder, MJPG
+	CODEC_H264				// AVIRecorder, H264
+};
+
+// Frames per segment; for H264 this is also the GOP length
+const unsigned int k_defaultSegmentFrames = 64;
+
+// JPEG quality, as in SaveToAvi
+const unsigned int k_defaultQuality = 75;
+
+struct TranscodeSettings
+{
+	string input;
+	string output;
+	transcodeCodec codec;
+	unsigned int numThreads;
+	unsigned int segmentFrames;
+	unsigned int quality;
+	float frameRate;
+};
+
+// This helper returns the name of a segment: the temporary file of the
+// built-in encoder, or the AVI file name (without .avi) for AVIRecorder.
+string GetSegmentName(const TranscodeSettings & settings, size_t segment)
+{
+	ostringstream name;
+	name << settings.output << (settings.codec == CODEC_MJPG ? ".seg" : "-") << segment;
+	return name.str();
+}
+
+// This helper converts a raw frame to what the encoders take: Mono8 stays
+// Mono8, everything else becomes BGR8.
+ImagePtr ConvertFrame(const JournalFileHeader & header, vector<uint8_t> & data)
+{
+	const PixelFormatEnums pixelFormat = static_cast<PixelFormatEnums>(header.pixelFormat);
+
+	ImagePtr rawImage = Image::Create(header.width, header.height, 0, 0, pixelFormat, &data[0]);
+
+	if (pixelFormat == PixelFormat_Mono8)
+	{
+		return rawImage;
+	}
+
+	return rawImage->Convert(PixelFormat_BGR8, HQ_LINEAR);
+}
+
+// This function JPEG-encodes one segment into a segment file: for every
+// frame a 4-byte size, then the JPEG data.
+int EncodeSegmentMjpg(const TranscodeSettings & settings, const JournaledReader & reader, size_t segment)
+{
+	const JournalFileHeader & header = reader.GetHeader();
+	const size_t first = segment * settings.segmentFrames;
+	const size_t last = min(first + settings.segmentFrames, reader.GetNumFrames());
+
+	FILE* segmentFile = fopen(GetSegmentName(settings, segment).c_str(), "wb");
+	if (segmentFile == NULL)
+	{
+		return -1;
+	}
+
+	vector<int> parameters;
+	parameters.push_back(IMWRITE_JPEG_QUALITY);
+	parameters.push_back(static_cast<int>(settings.quality));
+
+	vector<uint8_t> data;
+	vector<uchar> jpeg;
+	int result = 0;
+
+	for (size_t i = first; i < last && result == 0; i++)
+	{
+		if (reader.ReadFrame(i, data) != 0)
+		{
+			cout << "Skipping bad frame " << i << endl;
+			continue;
+		}
+
+		ImagePtr image = ConvertFrame(header, data);
+
+		Mat frame = cv::Mat(static_cast<int>(image->GetHeight()), static_cast<int>(image->GetWidth()),
+			image->GetPixelFormat() == PixelFormat_Mono8 ? CV_8UC1 : CV_8UC3, image->GetData(), image->GetStride());
+
+		if (!cv::imencode(".jpg", frame, jpeg, parameters))
+		{
+			result = -1;
+			break;
+		}
+
+		const uint32_t size = static_cast<uint32_t>(jpeg.size());
+		if (fwrite(&size, sizeof(size), 1, segmentFile) != 1 || fwrite(&jpeg[0], 1, size, segmentFile) != size)
+		{
+			result = -1;
+		}
+	}
+
+	if (fclose(segmentFile) != 0)
+	{
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function encodes one segment into an AVI file of its own with
+// AVIRecorder. Every worker has its own recorder.
+int EncodeSegmentSpinnaker(const TranscodeSettings & settings, const JournaledReader & reader, size_t segment)
+{
+	int result = 0;
+
+	const JournalFileHeader & header = reader.GetHeader();
+	const size_t first = segment * settings.segmentFrames;
+	const size_t last = min(first + settings.segmentFrames, reader.GetNumFrames());
+	const string aviFilename = GetSegmentName(settings, segment);
+
+	try
+	{
+		AVIRecorder aviRecorder;
+
+		if (settings.codec == CODEC_AVI)
+		{
+			AVIOption option;
+			option.frameRate = settings.frameRate;
+
+			aviRecorder.AVIOpen(aviFilename.c_str(), option);
+		}
+		else if (settings.codec == CODEC_SPIN_MJPG)
+		{
+			MJPGOption option;
+			option.frameRate = settings.frameRate;
+			option.quality = settings.quality;
+
+			aviRecorder.AVIOpen(aviFilename.c_str(), option);
+		}
+		else
+		{
+			H264Option option;
+			option.frameRate = settings.frameRate;
+			option.bitrate = 1000000;
+			option.height = header.height;
+			option.width = header.width;
+
+			aviRecorder.AVIOpen(aviFilename.c_str(), option);
+		}
+
+		vector<uint8_t> data;
+
+		for (size_t i = first; i < last; i++)
+		{
+			if (reader.ReadFrame(i, data) != 0)
+			{
+				cout << "Skipping bad frame " << i << endl;
+				continue;
+			}
+
+			aviRecorder.AVIAppend(ConvertFrame(header, data));
+		}
+
+		aviRecorder.AVIClose();
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function is the body of one worker thread: it claims segments until
+// all are taken. Each worker opens the recording itself.
+void EncodeSegments(const TranscodeSettings & settings, atomic<size_t> & nextSegment, size_t numSegments, int & result)
+{
+	JournaledReader reader;
+	if (reader.Open(settings.input) != 0)
+	{
+		result = -1;
+		return;
+	}
+
+	for (size_t segment = nextSegment++; segment < numSegments; segment = nextSegment++)
+	{
+		if (settings.codec == CODEC_MJPG)
+		{
+			result = result | EncodeSegmentMjpg(settings, reader, segment);
+		}
+		else
+		{
+			result = result | EncodeSegmentSpinnaker(settings, reader, segment);
+		}
+	}
+}
+
+// This function concatenates the segment files of the built-in encoder into
+// one AVI file and removes them.
+int ConcatenateSegments(const TranscodeSettings & settings, const JournalFileHeader & header, size_t numSegments)
+{
+	MjpegAviWriter writer;
+	if (writer.Open(settings.output + ".avi", header.width, header.height, settings.frameRate) != 0)
+	{
+		cout << "Unable to create " << settings.output << ".avi. Aborting..." << endl << endl;
+		return -1;
+	}
+
+	int result = 0;
+	vector<uint8_t> jpeg;
+
+	for (size_t segment = 0; segment < numSegments; segment++)
+	{
+		const string segmentName = GetSegmentName(settings, segment);
+
+		FILE* segmentFile = fopen(segmentName.c_str(), "rb");
+		if (segmentFile == NULL)
+		{
+			result = -1;
+			continue;
+		}
+
+		uint32_t size;
+		while (fread(&size, sizeof(size), 1, segmentFile) == 1)
+		{
+			jpeg.resize(size);
+			if (fread(&jpeg[0], 1, size, segmentFile) != size || writer.AppendFrame(&jpeg[0], size) != 0)
+			{
+				result = -1;
+				break;
+			}
+		}
+
+		fclose(segmentFile);
+		remove(segmentName.c_str());
+	}
+
+	if (writer.Close() != 0)
+	{
+		result = -1;
+	}
+
+	return result;
+}
+
+// This function transcodes a recording and reports the speed.
+int Transcode(TranscodeSettings & settings)
+{
+	JournaledReader reader;
+
+	int openResult = reader.Open(settings.input);
+	if (openResult != 0)
+	{
+		cout << "Unable to open " << settings.input << (openResult == -2 ? " (run JournaledRecording -recover first)" : "")
+			<< ". Aborting..." << endl << endl;
+		return -1;
+	}
+
+	const size_t numFrames = reader.GetNumFrames();
+	if (numFrames == 0)
+	{
+		cout << "No frames in " << settings.input << ". Aborting..." << endl << endl;
+		return -1;
+	}
+
+	// The camera timestamps give the time span and, unless set, the rate
+	double spanSeconds = 0.0;
+	if (numFrames > 1)
+	{
+		spanSeconds = (reader.GetEntry(numFrames - 1).cameraTimestampNs - reader.GetEntry(0).cameraTimestampNs) / 1e9;
+	}
+
+	if (settings.frameRate <= 0.0f)
+	{
+		settings.frameRate = spanSeconds > 0.0 ? static_cast<float>((numFrames - 1) / spanSeconds) : 15.0f;
+	}
+
+	// Count the last frame's period too
+	spanSeconds += 1.0 / settings.frameRate;
+
+	const size_t numSegments = (numFrames + settings.segmentFrames - 1) / settings.segmentFrames;
+	const unsigned int numThreads = static_cast<unsigned int>(min<size_t>(settings.numThreads, numSegments));
+
+	cout << "Transcoding " << numFrames << " frames (" << spanSeconds << " s at " << settings.frameRate << " fps) in "
+		<< numSegments << " segments on " << numThreads << " threads..." << endl;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+	atomic<size_t> nextSegment(0);
+	vector<thread> threads;
+	vector<int> threadResults(numThreads, 0);
+
+	for (unsigned int i = 0; i < numThreads; i++)
+	{
+		threads.push_back(thread(EncodeSegments, cref(settings), ref(nextSegment), numSegments, ref(threadResults[i])));
+	}
+
+	int result = 0;
+	for (unsigned int i = 0; i < numThreads; i++)
+	{
+		threads[i].join();
+		result = result | threadResults[i];
+	}
+
+	const double encodeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	if (settings.codec == CODEC_MJPG)
+	{
+		result = result | ConcatenateSegments(settings, reader.GetHeader(), numSegments);
+	}
+
+	const double totalSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	if (result != 0)
+	{
+		cout << "Transcoding failed." << endl;
+		return result;
+	}
+
+	cout << endl << "Encoding: " << encodeSeconds << " s" << endl;
+	if (settings.codec == CODEC_MJPG)
+	{
+		cout << "Concatenation: " << totalSeconds - encodeSeconds << " s" << endl;
+		cout << "Output: " << settings.output << ".avi" << endl;
+	}
+	else
+	{
+		cout << "Output: " << settings.output << "-0.avi ... " << settings.output << "-" << numSegments - 1 << ".avi" << endl;
+	}
+	cout << "Speed: " << numFrames / totalSeconds << " fps, " << spanSeconds / totalSeconds << "x real time" << endl;
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		cout << "Usage: Transcode input.jrn output [-c mjpg|avi|spin-mjpg|h264] [-t threads]" << endl;
+		cout << "\t[-g frames-per-segment] [-q quality] [-f frame-rate]" << endl;
+		return -1;
+	}
+
+	TranscodeSettings settings;
+	settings.input = argv[1];
+	settings.output = argv[2];
+	settings.codec = CODEC_MJPG;
+	settings.numThreads = max(1u, thread::hardware_concurrency());
+	settings.segmentFrames = k_defaultSegmentFrames;
+	settings.quality = k_defaultQuality;
+	settings.frameRate = 0.0f;
+
+	for (int i = 3; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-c") == 0)
+		{
+			if (strcmp(argv[i + 1], "avi") == 0)
+			{
+				settings.codec = CODEC_AVI;
+			}
+			else if (strcmp(argv[i + 1], "spin-mjpg") == 0)
+			{
+				settings.codec = CODEC_SPIN_MJPG;
+			}
+			else if (strcmp(argv[i + 1], "h264") == 0)
+			{
+				settings.codec = CODEC_H264;
+			}
+		}
+		else if (strcmp(argv[i], "-t") == 0)
+		{
+			settings.numThreads = max(1, atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-g") == 0)
+		{
+			settings.segmentFrames = max(1, atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-q") == 0)
+		{
+			settings.quality = static_cast<unsigned int>(atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-f") == 0)
+		{
+			settings.frameRate = static_cast<float>(atof(argv[i + 1]));
+		}
+	}
+
+	return Transcode(settings);
+}
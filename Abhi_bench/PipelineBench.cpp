@@ -0,0 +1,580 @@
+/**
+ *	@example PipelineBench.cpp
+ *
+ *	@brief PipelineBench.cpp measures the frame processing path of the Abhi
+ *	examples on synthetic frames, so no camera has to be attached. Frames come
+ *	from SyntheticCamera (see Abhi_common/SyntheticCamera.h) with a fixed seed,
+ *	and each scenario runs the same number of frames every time.
+ *
+ *	A scenario picks a camera count (one thread per camera), a pixel format
+ *	(Mono8 or BayerRG8) and the stages that run on every frame: Spinnaker
+ *	Convert() to BGR8, resize to preview size, JPEG encode and write to disk.
+ *	The "raw" scenarios only generate frames and give the floor of the others.
+ *
+ *	Results are written as JSON. When a baseline from an earlier run is given,
+ *	the frame rate of each scenario is compared against it and the program
+ *	exits with a nonzero status if any scenario got slower than the tolerance
+ *	allows. Unlike the camera examples it does not wait for Enter, so it can run
+ *	unattended.
+ *
+ *	Usage: PipelineBench [-o results.json] [-b baseline.json] [-t tolerance%]
+ *		[-n frames] [-s scenario-filter] [-d write-directory]
+ */
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/opencv.hpp>
+#include "SyntheticCamera.h"
+
+using namespace Spinnaker;
+using namespace Spinnaker::GenApi;
+using namespace Spinnaker::GenICam;
+using namespace std;
+using namespace cv;
+
+// Frames per camera and run, untimed warm-up frames, and runs per scenario
+const unsigned int k_defaultNumFrames = 300;
+const unsigned int k_numWarmupFrames = 20;
+const unsigned int k_numRepeats = 3;
+
+// Allowed frame rate drop against the baseline, in percent
+const double k_defaultTolerance = 10.0;
+
+// Preview size of the resize stage and quality of the encode stage
+const int k_previewWidth = 640;
+const int k_previewHeight = 480;
+const int k_jpegQuality = 90;
+
+// Files each camera cycles through in the write stage
+const unsigned int k_numWriteFiles = 8;
+
+// Stages run on every frame
+enum benchStage
+{
+	STAGE_CONVERT = 1,
+	STAGE_RESIZE = 2,
+	STAGE_ENCODE = 4,
+	STAGE_WRITE = 8
+};
+
+struct BenchScenario
+{
+	const char* name;
+	unsigned int numCameras;
+	syntheticFormat format;
+	unsigned int width;
+	unsigned int height;
+	unsigned int stages;
+};
+
+struct BenchResult
+{
+	BenchScenario scenario;
+	unsigned int numFrames;
+	double framesPerSecond;
+	double msPerFrameMean;
+	double msPerFrameP50;
+	double msPerFrameP99;
+	double cpuMsPerFrame;
+	double baselineFramesPerSecond;
+	bool regression;
+};
+
+// The standard scenarios. Names are the keys of the baseline; do not rename
+// a scenario without regenerating the baseline.
+const BenchScenario k_scenarios[] =
+{
+	{ "mono8_1cam_raw", 1, SYNTHETIC_MONO8, 1280, 1024, 0 },
+	{ "mono8_1cam_convert", 1, SYNTHETIC_MONO8, 1280, 1024, STAGE_CONVERT },
+	{ "mono8_1cam_convert_resize", 1, SYNTHETIC_MONO8, 1280, 1024, STAGE_CONVERT | STAGE_RESIZE },
+	{ "mono8_1cam_write", 1, SYNTHETIC_MONO8, 1280, 1024, STAGE_WRITE },
+	{ "bayer_1cam_raw", 1, SYNTHETIC_BAYER_RG8, 1280, 1024, 0 },
+	{ "bayer_1cam_convert", 1, SYNTHETIC_BAYER_RG8, 1280, 1024, STAGE_CONVERT },
+	{ "bayer_1cam_convert_resize", 1, SYNTHETIC_BAYER_RG8, 1280, 1024, STAGE_CONVERT | STAGE_RESIZE },
+	{ "bayer_1cam_convert_resize_encode", 1, SYNTHETIC_BAYER_RG8, 1280, 1024, STAGE_CONVERT | STAGE_RESIZE | STAGE_ENCODE },
+	{ "bayer_1cam_convert_encode_write", 1, SYNTHETIC_BAYER_RG8, 1280, 1024, STAGE_CONVERT | STAGE_ENCODE | STAGE_WRITE },
+	{ "mono8_4cam_raw", 4, SYNTHETIC_MONO8, 1280, 1024, 0 },
+	{ "mono8_4cam_convert_resize", 4, SYNTHETIC_MONO8, 1280, 1024, STAGE_CONVERT | STAGE_RESIZE },
+	{ "bayer_4cam_convert_resize_encode", 4, SYNTHETIC_BAYER_RG8, 1280, 1024, STAGE_CONVERT | STAGE_RESIZE | STAGE_ENCODE },
+	{ "bayer_4cam_convert_encode_write", 4, SYNTHETIC_BAYER_RG8, 1280, 1024, STAGE_CONVERT | STAGE_ENCODE | STAGE_WRITE }
+};
+
+// This helper returns user plus system CPU time of the process in milliseconds.
+double GetProcessCpuMs()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+		(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+// This helper returns the stages of a scenario as text, e.g. "convert+resize".
+string GetStageNames(unsigned int stages)
+{
+	const unsigned int stageBits[] = { STAGE_CONVERT, STAGE_RESIZE, STAGE_ENCODE, STAGE_WRITE };
+	const char* stageNames[] = { "convert", "resize", "encode", "write" };
+
+	string names;
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		if (stages & stageBits[i])
+		{
+			names += names.empty() ? "" : "+";
+			names += stageNames[i];
+		}
+	}
+
+	return names.empty() ? "raw" : names;
+}
+
+// This function runs all stages of a scenario on one synthetic frame.
+void ProcessFrame(const BenchScenario & scenario, const uint8_t* data, const string & writePath, vector<uchar> & encoded)
+{
+	Mat image;
+	ImagePtr convertedImage;
+
+	if (scenario.stages & STAGE_CONVERT)
+	{
+		PixelFormatEnums sourceFormat = scenario.format == SYNTHETIC_MONO8 ? PixelFormat_Mono8 : PixelFormat_BayerRG8;
+
+		ImagePtr rawImage = Image::Create(scenario.width, scenario.height, 0, 0, sourceFormat, const_cast<uint8_t*>(data));
+		convertedImage = rawImage->Convert(PixelFormat_BGR8, HQ_LINEAR);
+
+		image = cv::Mat(convertedImage->GetHeight(), convertedImage->GetWidth(), CV_8UC3,
+			convertedImage->GetData(), convertedImage->GetImageSize() / convertedImage->GetHeight());
+	}
+	else
+	{
+		image = cv::Mat(scenario.height, scenario.width, CV_8UC1, const_cast<uint8_t*>(data), scenario.width);
+	}
+
+	if (scenario.stages & STAGE_RESIZE)
+	{
+		Mat preview;
+		cv::resize(image, preview, Size(k_previewWidth, k_previewHeight), 0, 0, INTER_LINEAR);
+		image = preview;
+	}
+
+	const uchar* output = image.data;
+	size_t outputSize = image.total() * image.elemSize();
+
+	if (scenario.stages & STAGE_ENCODE)
+	{
+		vector<int> params;
+		params.push_back(IMWRITE_JPEG_QUALITY);
+		params.push_back(k_jpegQuality);
+
+		cv::imencode(".jpg", image, encoded, params);
+
+		output = encoded.empty() ? NULL : &encoded[0];
+		outputSize = encoded.size();
+	}
+
+	if (scenario.stages & STAGE_WRITE)
+	{
+		FILE* file = fopen(writePath.c_str(), "wb");
+		if (file != NULL)
+		{
+			if (outputSize > 0 && image.isContinuous())
+			{
+				fwrite(output, 1, outputSize, file);
+			}
+			fclose(file);
+		}
+	}
+}
+
+// This function is the body of one camera thread: it processes warm-up frames,
+// then numFrames timed frames, and records the time each timed one took.
+void RunCamera(const BenchScenario & scenario, SyntheticCamera & camera, unsigned int camNum, unsigned int numFrames,
+	const string & writeDir, vector<double> & latenciesMs, double & elapsedSeconds, int & result)
+{
+	vector<uchar> encoded;
+
+	latenciesMs.clear();
+	latenciesMs.reserve(numFrames);
+	camera.Rewind();
+
+	try
+	{
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+		for (unsigned int imageCnt = 0; imageCnt < k_numWarmupFrames + numFrames; imageCnt++)
+		{
+			ostringstream writePath;
+			writePath << writeDir << "/cam" << camNum << "_" << imageCnt % k_numWriteFiles
+				<< ((scenario.stages & STAGE_ENCODE) ? ".jpg" : ".raw");
+
+			if (imageCnt == k_numWarmupFrames)
+			{
+				start = chrono::steady_clock::now();
+			}
+
+			chrono::steady_clock::time_point frameStart = chrono::steady_clock::now();
+
+			ProcessFrame(scenario, camera.NextFrame(), writePath.str(), encoded);
+
+			chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - frameStart;
+
+			if (imageCnt >= k_numWarmupFrames)
+			{
+				latenciesMs.push_back(elapsed.count());
+			}
+		}
+
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+		elapsedSeconds = elapsed.count();
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		cout << "Error: " << e.what() << endl;
+		result = -1;
+	}
+}
+
+// This helper returns the given percentile of a sorted list.
+double GetPercentile(const vector<double> & sorted, double percentile)
+{
+	if (sorted.empty())
+	{
+		return 0.0;
+	}
+
+	size_t index = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1) + 0.5);
+	return sorted[min(index, sorted.size() - 1)];
+}
+
+// This function runs a scenario k_numRepeats times. The frame rate is the
+// median over the runs; latencies are taken over all frames of all runs.
+int RunScenario(const BenchScenario & scenario, unsigned int numFrames, const string & writeDir, BenchResult & benchResult)
+{
+	int result = 0;
+
+	vector<double> runFramesPerSecond;
+	vector<double> allLatenciesMs;
+	double cpuMs = 0.0;
+
+	// Render the scenes up front so that is not timed
+	vector<SyntheticCamera*> cameras;
+	for (unsigned int i = 0; i < scenario.numCameras; i++)
+	{
+		cameras.push_back(new SyntheticCamera(scenario.width, scenario.height, scenario.format, i + 1));
+	}
+
+	for (unsigned int repeat = 0; repeat < k_numRepeats; repeat++)
+	{
+		vector<vector<double> > latenciesMs(scenario.numCameras);
+		vector<double> elapsedSeconds(scenario.numCameras, 0.0);
+		vector<int> threadResults(scenario.numCameras, 0);
+		vector<thread> threads;
+
+		double cpuStartMs = GetProcessCpuMs();
+
+		for (unsigned int i = 0; i < scenario.numCameras; i++)
+		{
+			threads.push_back(thread(RunCamera, cref(scenario), ref(*cameras[i]), i, numFrames, cref(writeDir),
+				ref(latenciesMs[i]), ref(elapsedSeconds[i]), ref(threadResults[i])));
+		}
+
+		// The slowest camera determines the rate of the run
+		double slowestSeconds = 0.0;
+
+		for (unsigned int i = 0; i < scenario.numCameras; i++)
+		{
+			threads[i].join();
+			result = result | threadResults[i];
+			slowestSeconds = max(slowestSeconds, elapsedSeconds[i]);
+			allLatenciesMs.insert(allLatenciesMs.end(), latenciesMs[i].begin(), latenciesMs[i].end());
+		}
+
+		cpuMs += GetProcessCpuMs() - cpuStartMs;
+
+		if (slowestSeconds > 0.0)
+		{
+			runFramesPerSecond.push_back(scenario.numCameras * numFrames / slowestSeconds);
+		}
+	}
+
+	for (unsigned int i = 0; i < scenario.numCameras; i++)
+	{
+		delete cameras[i];
+	}
+
+	if (runFramesPerSecond.empty())
+	{
+		runFramesPerSecond.push_back(0.0);
+	}
+
+	sort(runFramesPerSecond.begin(), runFramesPerSecond.end());
+	sort(allLatenciesMs.begin(), allLatenciesMs.end());
+
+	double totalMs = 0.0;
+	for (size_t i = 0; i < allLatenciesMs.size(); i++)
+	{
+		totalMs += allLatenciesMs[i];
+	}
+
+	// CPU time covers the warm-up frames too
+	const double numProcessed = static_cast<double>(k_numRepeats) * scenario.numCameras * (numFrames + k_numWarmupFrames);
+
+	benchResult.scenario = scenario;
+	benchResult.numFrames = numFrames;
+	benchResult.framesPerSecond = runFramesPerSecond[runFramesPerSecond.size() / 2];
+	benchResult.msPerFrameMean = allLatenciesMs.empty() ? 0.0 : totalMs / allLatenciesMs.size();
+	benchResult.msPerFrameP50 = GetPercentile(allLatenciesMs, 50.0);
+	benchResult.msPerFrameP99 = GetPercentile(allLatenciesMs, 99.0);
+	benchResult.cpuMsPerFrame = cpuMs / numProcessed;
+	benchResult.baselineFramesPerSecond = 0.0;
+	benchResult.regression = false;
+
+	return result;
+}
+
+// This function reads the frame rate of each scenario from an earlier results
+// file. It only understands the layout WriteResults() produces: one scenario
+// object per line.
+int ReadBaseline(const string & path, map<string, double> & baseline)
+{
+	ifstream file(path.c_str());
+	if (!file.is_open())
+	{
+		cout << "Unable to open baseline " << path << ". Aborting..." << endl << endl;
+		return -1;
+	}
+
+	string line;
+	while (getline(file, line))
+	{
+		const string nameKey = "\"name\": \"";
+		const string fpsKey = "\"fps\": ";
+
+		size_t namePos = line.find(nameKey);
+		size_t fpsPos = line.find(fpsKey);
+		if (namePos == string::npos || fpsPos == string::npos)
+		{
+			continue;
+		}
+
+		namePos += nameKey.size();
+		size_t nameEnd = line.find('"', namePos);
+		if (nameEnd == string::npos)
+		{
+			continue;
+		}
+
+		baseline[line.substr(namePos, nameEnd - namePos)] = atof(line.c_str() + fpsPos + fpsKey.size());
+	}
+
+	return 0;
+}
+
+// This function writes the results as JSON, one scenario per line.
+void WriteResults(ostream & out, const vector<BenchResult> & results, bool hasBaseline, double tolerance)
+{
+	out << "{" << endl;
+	out << "  \"benchmark\": \"PipelineBench\"," << endl;
+	out << "  \"warmup_frames\": " << k_numWarmupFrames << "," << endl;
+	out << "  \"repeats\": " << k_numRepeats << "," << endl;
+	out << "  \"hardware_threads\": " << thread::hardware_concurrency() << "," << endl;
+	if (hasBaseline)
+	{
+		out << "  \"tolerance_pct\": " << tolerance << "," << endl;
+	}
+	out << "  \"scenarios\": [" << endl;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult & r = results[i];
+
+		out << "    {\"name\": \"" << r.scenario.name << "\""
+			<< ", \"cameras\": " << r.scenario.numCameras
+			<< ", \"format\": \"" << (r.scenario.format == SYNTHETIC_MONO8 ? "Mono8" : "BayerRG8") << "\""
+			<< ", \"width\": " << r.scenario.width
+			<< ", \"height\": " << r.scenario.height
+			<< ", \"stages\": \"" << GetStageNames(r.scenario.stages) << "\""
+			<< ", \"frames\": " << r.numFrames
+			<< ", \"fps\": " << r.framesPerSecond
+			<< ", \"ms_mean\": " << r.msPerFrameMean
+			<< ", \"ms_p50\": " << r.msPerFrameP50
+			<< ", \"ms_p99\": " << r.msPerFrameP99
+			<< ", \"cpu_ms_per_frame\": " << r.cpuMsPerFrame;
+
+		if (hasBaseline && r.baselineFramesPerSecond > 0.0)
+		{
+			out << ", \"baseline_fps\": " << r.baselineFramesPerSecond
+				<< ", \"change_pct\": " << 100.0 * (r.framesPerSecond / r.baselineFramesPerSecond - 1.0)
+				<< ", \"regression\": " << (r.regression ? "true" : "false");
+		}
+
+		out << "}" << (i + 1 < results.size() ? "," : "") << endl;
+	}
+
+	out << "  ]" << endl;
+	out << "}" << endl;
+}
+
+// Example entry point
+int main(int argc, char** argv)
+{
+	int result = 0;
+
+	string outputPath;
+	string baselinePath;
+	string filter;
+	string writeDir = "/tmp/PipelineBench";
+	double tolerance = k_defaultTolerance;
+	unsigned int numFrames = k_defaultNumFrames;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "-o") == 0)
+		{
+			outputPath = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "-b") == 0)
+		{
+			baselinePath = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "-t") == 0)
+		{
+			tolerance = atof(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-n") == 0)
+		{
+			numFrames = static_cast<unsigned int>(atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "-s") == 0)
+		{
+			filter = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "-d") == 0)
+		{
+			writeDir = argv[i + 1];
+		}
+		else
+		{
+			cout << "Unknown option " << argv[i] << ". Aborting..." << endl << endl;
+			return -1;
+		}
+	}
+
+	if (numFrames == 0)
+	{
+		cout << "Frame count must be positive. Aborting..." << endl << endl;
+		return -1;
+	}
+
+	map<string, double> baseline;
+	if (!baselinePath.empty() && ReadBaseline(baselinePath, baseline) != 0)
+	{
+		return -1;
+	}
+
+	mkdir(writeDir.c_str(), 0755);
+
+	cout << endl << "*** PIPELINE BENCHMARK ***" << endl << endl;
+
+	vector<BenchResult> results;
+	bool anyRegression = false;
+
+	for (size_t i = 0; i < sizeof(k_scenarios) / sizeof(k_scenarios[0]); i++)
+	{
+		const BenchScenario & scenario = k_scenarios[i];
+
+		if (!filter.empty() && string(scenario.name).find(filter) == string::npos)
+		{
+			continue;
+		}
+
+		BenchResult benchResult;
+		result = result | RunScenario(scenario, numFrames, writeDir, benchResult);
+
+		map<string, double>::const_iterator it = baseline.find(scenario.name);
+		if (it != baseline.end() && it->second > 0.0)
+		{
+			benchResult.baselineFramesPerSecond = it->second;
+			benchResult.regression = benchResult.framesPerSecond < it->second * (1.0 - tolerance / 100.0);
+			anyRegression = anyRegression || benchResult.regression;
+		}
+
+		cout << scenario.name << ": " << benchResult.framesPerSecond << " fps, "
+			<< benchResult.msPerFrameP50 << " ms p50, " << benchResult.msPerFrameP99 << " ms p99, "
+			<< benchResult.cpuMsPerFrame << " ms CPU per frame";
+
+		if (benchResult.baselineFramesPerSecond > 0.0)
+		{
+			cout << " (baseline " << benchResult.baselineFramesPerSecond << " fps"
+				<< (benchResult.regression ? ", REGRESSION)" : ")");
+		}
+		else if (!baseline.empty())
+		{
+			cout << " (not in baseline)";
+		}
+
+		cout << endl;
+
+		results.push_back(benchResult);
+	}
+
+	// Remove what the write stage left behind
+	unsigned int maxCameras = 0;
+	for (size_t i = 0; i < sizeof(k_scenarios) / sizeof(k_scenarios[0]); i++)
+	{
+		maxCameras = max(maxCameras, k_scenarios[i].numCameras);
+	}
+
+	for (unsigned int cam = 0; cam < maxCameras; cam++)
+	{
+		for (unsigned int file = 0; file < k_numWriteFiles; file++)
+		{
+			ostringstream path;
+			path << writeDir << "/cam" << cam << "_" << file;
+			remove((path.str() + ".jpg").c_str());
+			remove((path.str() + ".raw").c_str());
+		}
+	}
+
+	if (outputPath.empty())
+	{
+		cout << endl;
+		WriteResults(cout, results, !baseline.empty(), tolerance);
+	}
+	else
+	{
+		ofstream out(outputPath.c_str());
+		if (!out.is_open())
+		{
+			cout << "Unable to write results to " << outputPath << ". Aborting..." << endl << endl;
+			return -1;
+		}
+
+		WriteResults(out, results, !baseline.empty(), tolerance);
+
+		cout << endl << "Results written to " << outputPath << endl;
+	}
+
+	if (anyRegression)
+	{
+		cout << endl << "Frame rate regression beyond " << tolerance << "% detected!" << endl;
+		result = -1;
+	}
+
+	return result;
+}
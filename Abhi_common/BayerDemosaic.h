@@ -0,0 +1,103 @@
+//
+// BayerDemosaic.h
+//
+// In-house bilinear demosaicing of BayerRG8 (RGGB) to BGR8. Each missing
+// colour is the mean of its nearest samples of that colour; borders are
+// mirrored so the Bayer phase is kept. Quality is about that of Spinnaker's
+// NEAREST_NEIGHBOR_AVG/BILINEAR; it is meant as a cheap baseline and for
+// paths that only need a preview.
+//
+// The function works on a range of output rows so a frame can be split into
+// stripes and converted in parallel (see StripeWorkerPool.h); every row
+// only reads the source, so stripes never interfere.
+//
+
+#ifndef ABHI_BAYER_DEMOSAIC_H
+#define ABHI_BAYER_DEMOSAIC_H
+
+#include <stdint.h>
+#include <cstddef>
+
+// Mirrors an index into [0, n) without repeating the edge sample, which keeps
+// the row/column parity and thus the Bayer colour
+inline int MirrorIndex(int i, int n)
+{
+	if (i < 0)
+	{
+		return -i;
+	}
+	if (i >= n)
+	{
+		return 2 * n - 2 - i;
+	}
+	return i;
+}
+
+// Demosaics the pixel at x given the columns to its left and right.
+inline void DemosaicBilinearPixelRGGB(const uint8_t* up, const uint8_t* mid, const uint8_t* down,
+	int x, int xl, int xr, bool redRow, uint8_t* out)
+{
+	const int centre = mid[x];
+	const int horizontal = (mid[xl] + mid[xr] + 1) >> 1;
+	const int vertical = (up[x] + down[x] + 1) >> 1;
+
+	const bool evenX = (x & 1) == 0;
+
+	if (redRow == evenX)
+	{
+		// R or B sample: G from the four neighbours, the other colour from
+		// the four diagonals
+		const int cross = (mid[xl] + mid[xr] + up[x] + down[x] + 2) >> 2;
+		const int diagonal = (up[xl] + up[xr] + down[xl] + down[xr] + 2) >> 2;
+
+		out[0] = static_cast<uint8_t>(redRow ? diagonal : centre);
+		out[1] = static_cast<uint8_t>(cross);
+		out[2] = static_cast<uint8_t>(redRow ? centre : diagonal);
+	}
+	else
+	{
+		// G sample: the colour of this row from the left and right, the
+		// other one from above and below
+		out[0] = static_cast<uint8_t>(redRow ? vertical : horizontal);
+		out[1] = static_cast<uint8_t>(centre);
+		out[2] = static_cast<uint8_t>(redRow ? horizontal : vertical);
+	}
+}
+
+// Demosaics one row. up/mid/down are the source rows above, at and below the
+// output row; redRow is set for rows holding R and G samples.
+inline void DemosaicBilinearRowRGGB(const uint8_t* up, const uint8_t* mid, const uint8_t* down,
+	int width, bool redRow, uint8_t* out)
+{
+	DemosaicBilinearPixelRGGB(up, mid, down, 0, 1, 1, redRow, out);
+
+	// Interior without mirroring, one R/G or G/B pair at a time
+	int x = 1;
+	for (; x + 2 < width; x += 2)
+	{
+		DemosaicBilinearPixelRGGB(up, mid, down, x, x - 1, x + 1, redRow, out + 3 * x);
+		DemosaicBilinearPixelRGGB(up, mid, down, x + 1, x, x + 2, redRow, out + 3 * (x + 1));
+	}
+
+	for (; x < width; x++)
+	{
+		DemosaicBilinearPixelRGGB(up, mid, down, x, x - 1, MirrorIndex(x + 1, width), redRow, out + 3 * x);
+	}
+}
+
+// Demosaics rows [rowBegin, rowEnd) of a BayerRG8 frame into BGR8. Width and
+// height must be at least 2.
+inline void DemosaicBilinearRGGB(const uint8_t* src, size_t srcStride, uint8_t* dst, size_t dstStride,
+	int width, int height, int rowBegin, int rowEnd)
+{
+	for (int y = rowBegin; y < rowEnd; y++)
+	{
+		const uint8_t* up = src + MirrorIndex(y - 1, height) * srcStride;
+		const uint8_t* mid = src + y * srcStride;
+		const uint8_t* down = src + MirrorIndex(y + 1, height) * srcStride;
+
+		DemosaicBilinearRowRGGB(up, mid, down, width, (y & 1) == 0, dst + y * dstStride);
+	}
+}
+
+#endif // ABHI_BAYER_DEMOSAIC_H
@@ -0,0 +1,543 @@
+//
+// BlobTracker.h
+//
+// Finds bright markers in Mono8 frames and returns their intensity-weighted,
+// sub-pixel centroids. Intended for tracking at several hundred frames per
+// second where contour finding on a converted frame is too slow.
+//
+// Each frame is split into horizontal stripes that are processed in parallel
+// on a StripeWorkerPool. Within a stripe, rows are thresholded 16 pixels at a
+// time with SSE2 and turned directly into runs of foreground pixels; runs that
+// touch on consecutive rows (8-connectivity) are joined with union-find. Runs
+// meeting across stripe borders are joined afterwards, and moments are summed
+// per component.
+//
+// When predicted windows are enabled, only windows around the previous
+// centroids are processed. A full frame is processed every
+// fullFrameInterval frames, and whenever a blob reaches a window border or a
+// marker is lost, so new or fast markers are picked up again.
+//
+
+#ifndef ABHI_BLOB_TRACKER_H
+#define ABHI_BLOB_TRACKER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <emmintrin.h>
+#include "StripeWorkerPool.h"
+
+// One detected marker
+struct Blob
+{
+	double centroidX;
+	double centroidY;
+	unsigned int area;
+	double sumIntensity;
+	int minX;
+	int minY;
+	int maxX;
+	int maxY;
+};
+
+struct BlobTrackerParams
+{
+	BlobTrackerParams()
+		: threshold(200), minArea(3), maxArea(100000), numStripes(0),
+		usePredictedWindows(false), windowRadius(32), fullFrameInterval(50)
+	{
+	}
+
+	uint8_t threshold;				// Pixels strictly above are foreground
+	unsigned int minArea;			// Smaller components are discarded
+	unsigned int maxArea;			// Larger components are discarded
+	unsigned int numStripes;		// 0 selects twice the number of threads
+	bool usePredictedWindows;		// Restrict to windows around previous centroids
+	int windowRadius;				// Half size of a predicted window in pixels
+	unsigned int fullFrameInterval;	// Full-frame pass every this many frames
+};
+
+// Per-frame latency statistics in microseconds
+struct BlobTrackerStats
+{
+	BlobTrackerStats() : numFrames(0), numFullFrames(0), lastUs(0.0), totalUs(0.0), maxUs(0.0) {}
+
+	unsigned long long numFrames;
+	unsigned long long numFullFrames;
+	double lastUs;
+	double totalUs;
+	double maxUs;
+};
+
+class BlobTracker
+{
+public:
+
+	BlobTracker(StripeWorkerPool & pool, const BlobTrackerParams & params = BlobTrackerParams())
+		: m_pool(pool), m_params(params), m_framesSinceFull(0)
+	{
+	}
+
+	const BlobTrackerParams & GetParams() const { return m_params; }
+	const BlobTrackerStats & GetStats() const { return m_stats; }
+	const std::vector<Blob> & GetBlobs() const { return m_blobs; }
+
+	// Processes one Mono8 frame and returns the blobs found in it
+	const std::vector<Blob> & TrackFrame(const uint8_t* data, int width, int height, size_t stride)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		bool fullFrame = !m_params.usePredictedWindows || m_blobs.empty() ||
+			m_framesSinceFull + 1 >= m_params.fullFrameInterval;
+
+		if (!fullFrame)
+		{
+			std::vector<Blob> previousBlobs;
+			previousBlobs.swap(m_blobs);
+
+			// Fall back to a full frame if a marker may have left its window
+			if (!TrackWindows(data, width, height, stride, previousBlobs) || m_blobs.size() < previousBlobs.size())
+			{
+				fullFrame = true;
+			}
+		}
+
+		if (fullFrame)
+		{
+			TrackRegion(data, stride, 0, 0, width, height, m_blobs, m_scratch);
+			m_framesSinceFull = 0;
+			m_stats.numFullFrames++;
+		}
+		else
+		{
+			m_framesSinceFull++;
+		}
+
+		std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+		m_stats.numFrames++;
+		m_stats.lastUs = elapsed.count();
+		m_stats.totalUs += elapsed.count();
+		m_stats.maxUs = std::max(m_stats.maxUs, elapsed.count());
+
+		return m_blobs;
+	}
+
+private:
+
+	// A horizontal run of foreground pixels with its partial moments
+	struct Run
+	{
+		int y;
+		int xStart;		// Inclusive
+		int xEnd;		// Exclusive
+		unsigned int parent;
+		double sumW;
+		double sumWX;
+	};
+
+	// Runs of one stripe
+	struct StripeRuns
+	{
+		int yStart;
+		int yEnd;
+		std::vector<Run> runs;
+		std::vector<size_t> rowStart;	// Index of the first run of each row, plus end
+	};
+
+	// Buffers for merging runs; reused between frames
+	struct MergeScratch
+	{
+		std::vector<Run> allRuns;
+		std::vector<int> blobIndex;
+	};
+
+	// Labels all components inside [x0, x0 + w) x [y0, y0 + h). Stripes run on
+	// the pool unless parallel is false (used when already on a pool thread).
+	void TrackRegion(const uint8_t* data, size_t stride, int x0, int y0, int w, int h,
+		std::vector<Blob> & blobs, MergeScratch & scratch, bool parallel = true)
+	{
+		unsigned int numStripes = m_params.numStripes > 0 ? m_params.numStripes : 2 * m_pool.GetNumThreads();
+		if (!parallel)
+		{
+			numStripes = 1;
+		}
+		numStripes = std::max(1u, std::min(numStripes, static_cast<unsigned int>(h)));
+
+		std::vector<StripeRuns> stripes(numStripes);
+
+		for (unsigned int s = 0; s < numStripes; s++)
+		{
+			stripes[s].yStart = y0 + static_cast<int>((static_cast<long long>(h) * s) / numStripes);
+			stripes[s].yEnd = y0 + static_cast<int>((static_cast<long long>(h) * (s + 1)) / numStripes);
+		}
+
+		StripeWorkerPool::StripeTask task = [&](unsigned int s)
+		{
+			LabelStripe(data, stride, x0, w, stripes[s], m_params.threshold);
+		};
+
+		if (parallel)
+		{
+			m_pool.Run(numStripes, task);
+		}
+		else
+		{
+			task(0);
+		}
+
+		MergeStripes(stripes, blobs, scratch);
+	}
+
+	// Processes a window around every previous centroid. Returns false if a
+	// blob touches a window border, i.e. may extend outside it.
+	bool TrackWindows(const uint8_t* data, int width, int height, size_t stride, const std::vector<Blob> & previousBlobs)
+	{
+		struct Window
+		{
+			int x0, y0, w, h;
+			std::vector<Blob> blobs;
+		};
+
+		std::vector<Window> windows(previousBlobs.size());
+
+		for (size_t i = 0; i < previousBlobs.size(); i++)
+		{
+			int x0 = std::max(0, static_cast<int>(previousBlobs[i].centroidX) - m_params.windowRadius);
+			int y0 = std::max(0, static_cast<int>(previousBlobs[i].centroidY) - m_params.windowRadius);
+			int x1 = std::min(width, static_cast<int>(previousBlobs[i].centroidX) + m_params.windowRadius + 1);
+			int y1 = std::min(height, static_cast<int>(previousBlobs[i].centroidY) + m_params.windowRadius + 1);
+
+			windows[i].x0 = x0;
+			windows[i].y0 = y0;
+			windows[i].w = std::max(0, x1 - x0);
+			windows[i].h = std::max(0, y1 - y0);
+		}
+
+		// One window per task; windows are small, so each is labelled inline
+		m_pool.Run(static_cast<unsigned int>(windows.size()), [&](unsigned int i)
+		{
+			if (windows[i].w > 0 && windows[i].h > 0)
+			{
+				MergeScratch scratch;
+				TrackRegion(data, stride, windows[i].x0, windows[i].y0, windows[i].w, windows[i].h, windows[i].blobs, scratch, false);
+			}
+		});
+
+		bool allInside = true;
+
+		for (size_t i = 0; i < windows.size(); i++)
+		{
+			const Window & window = windows[i];
+
+			for (size_t b = 0; b < window.blobs.size(); b++)
+			{
+				const Blob & blob = window.blobs[b];
+
+				bool touchesBorder =
+					(blob.minX == window.x0 && window.x0 > 0) ||
+					(blob.minY == window.y0 && window.y0 > 0) ||
+					(blob.maxX == window.x0 + window.w - 1 && window.x0 + window.w < width) ||
+					(blob.maxY == window.y0 + window.h - 1 && window.y0 + window.h < height);
+
+				if (touchesBorder)
+				{
+					allInside = false;
+				}
+
+				// Overlapping windows can see the same blob twice
+				bool duplicate = false;
+				for (size_t k = 0; k < m_blobs.size() && !duplicate; k++)
+				{
+					duplicate = m_blobs[k].minX == blob.minX && m_blobs[k].minY == blob.minY &&
+						m_blobs[k].area == blob.area;
+				}
+
+				if (!duplicate)
+				{
+					m_blobs.push_back(blob);
+				}
+			}
+		}
+
+		return allInside;
+	}
+
+	// This function returns a 16-bit mask of the pixels above threshold
+	static inline unsigned int ThresholdMask16(const uint8_t* pixels, __m128i thresholdPlusOne)
+	{
+		__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+
+		// max(v, t + 1) == v  <=>  v > t, for unsigned bytes
+		__m128i above = _mm_cmpeq_epi8(_mm_max_epu8(values, thresholdPlusOne), values);
+
+		return static_cast<unsigned int>(_mm_movemask_epi8(above));
+	}
+
+	// Finds the root of a run with path halving
+	static unsigned int FindRoot(std::vector<Run> & runs, unsigned int i)
+	{
+		while (runs[i].parent != i)
+		{
+			runs[i].parent = runs[runs[i].parent].parent;
+			i = runs[i].parent;
+		}
+		return i;
+	}
+
+	static void Unite(std::vector<Run> & runs, unsigned int a, unsigned int b)
+	{
+		a = FindRoot(runs, a);
+		b = FindRoot(runs, b);
+
+		if (a < b)
+		{
+			runs[b].parent = a;
+		}
+		else if (b < a)
+		{
+			runs[a].parent = b;
+		}
+	}
+
+	// Extracts runs from the rows of one stripe and joins touching runs
+	static void LabelStripe(const uint8_t* data, size_t stride, int x0, int w, StripeRuns & stripe, uint8_t threshold)
+	{
+		stripe.runs.clear();
+		stripe.rowStart.clear();
+
+		if (threshold == 255)
+		{
+			stripe.rowStart.assign(stripe.yEnd - stripe.yStart + 1, 0);
+			return;
+		}
+
+		const __m128i thresholdPlusOne = _mm_set1_epi8(static_cast<char>(threshold + 1));
+
+		for (int y = stripe.yStart; y < stripe.yEnd; y++)
+		{
+			const uint8_t* row = data + y * stride + x0;
+
+			stripe.rowStart.push_back(stripe.runs.size());
+
+			int runStart = -1;
+			int x = 0;
+
+			// 16 pixels at a time; blocks without any change are skipped
+			for (; x + 16 <= w; x += 16)
+			{
+				unsigned int mask = ThresholdMask16(row + x, thresholdPlusOne);
+
+				if ((runStart < 0 && mask == 0) || (runStart >= 0 && mask == 0xFFFF))
+				{
+					continue;
+				}
+
+				for (int bit = 0; bit < 16; bit++)
+				{
+					bool above = (mask >> bit) & 1;
+
+					if (above && runStart < 0)
+					{
+						runStart = x + bit;
+					}
+					else if (!above && runStart >= 0)
+					{
+						AddRun(stripe.runs, row, y, runStart, x + bit, x0);
+						runStart = -1;
+					}
+				}
+			}
+
+			// Remaining pixels
+			for (; x < w; x++)
+			{
+				bool above = row[x] > threshold;
+
+				if (above && runStart < 0)
+				{
+					runStart = x;
+				}
+				else if (!above && runStart >= 0)
+				{
+					AddRun(stripe.runs, row, y, runStart, x, x0);
+					runStart = -1;
+				}
+			}
+
+			if (runStart >= 0)
+			{
+				AddRun(stripe.runs, row, y, runStart, w, x0);
+			}
+
+			// Join with runs of the previous row of this stripe
+			if (stripe.rowStart.size() > 1)
+			{
+				size_t previousBegin = stripe.rowStart[stripe.rowStart.size() - 2];
+				size_t currentBegin = stripe.rowStart.back();
+
+				JoinRows(stripe.runs, previousBegin, currentBegin, currentBegin, stripe.runs.size());
+			}
+		}
+
+		stripe.rowStart.push_back(stripe.runs.size());
+	}
+
+	// Adds a run; x coordinates are relative to the region, stored absolute
+	static void AddRun(std::vector<Run> & runs, const uint8_t* row, int y, int xStart, int xEnd, int x0)
+	{
+		Run run;
+		run.y = y;
+		run.xStart = xStart + x0;
+		run.xEnd = xEnd + x0;
+		run.parent = static_cast<unsigned int>(runs.size());
+		run.sumW = 0.0;
+		run.sumWX = 0.0;
+
+		unsigned int sumW = 0;
+		unsigned long long sumWX = 0;
+
+		for (int x = xStart; x < xEnd; x++)
+		{
+			sumW += row[x];
+			sumWX += static_cast<unsigned long long>(row[x]) * (x + x0);
+		}
+
+		run.sumW = sumW;
+		run.sumWX = static_cast<double>(sumWX);
+
+		runs.push_back(run);
+	}
+
+	// Unites 8-connected runs of two consecutive rows
+	static void JoinRows(std::vector<Run> & runs, size_t aBegin, size_t aEnd, size_t bBegin, size_t bEnd)
+	{
+		size_t a = aBegin;
+		size_t b = bBegin;
+
+		while (a < aEnd && b < bEnd)
+		{
+			// [s, e) and [s', e') touch diagonally when s <= e' and s' <= e
+			if (runs[a].xStart <= runs[b].xEnd && runs[b].xStart <= runs[a].xEnd)
+			{
+				Unite(runs, static_cast<unsigned int>(a), static_cast<unsigned int>(b));
+			}
+
+			if (runs[a].xEnd < runs[b].xEnd)
+			{
+				a++;
+			}
+			else
+			{
+				b++;
+			}
+		}
+	}
+
+	// Joins runs across stripe borders and sums moments per component
+	void MergeStripes(std::vector<StripeRuns> & stripes, std::vector<Blob> & blobs, MergeScratch & scratch)
+	{
+		std::vector<Run> & allRuns = scratch.allRuns;
+		std::vector<int> & blobIndex = scratch.blobIndex;
+
+		// Concatenate all runs so parents can be global indices
+		allRuns.clear();
+
+		std::vector<size_t> offsets(stripes.size());
+		for (size_t s = 0; s < stripes.size(); s++)
+		{
+			offsets[s] = allRuns.size();
+
+			for (size_t i = 0; i < stripes[s].runs.size(); i++)
+			{
+				Run run = stripes[s].runs[i];
+				run.parent += static_cast<unsigned int>(offsets[s]);
+				allRuns.push_back(run);
+			}
+		}
+
+		// Join the last row of each stripe with the first row of the next
+		for (size_t s = 0; s + 1 < stripes.size(); s++)
+		{
+			const StripeRuns & upper = stripes[s];
+			const StripeRuns & lower = stripes[s + 1];
+
+			if (upper.rowStart.size() < 2 || lower.rowStart.size() < 2)
+			{
+				continue;
+			}
+
+			size_t aBegin = offsets[s] + upper.rowStart[upper.rowStart.size() - 2];
+			size_t aEnd = offsets[s] + upper.rowStart.back();
+			size_t bBegin = offsets[s + 1] + lower.rowStart[0];
+			size_t bEnd = offsets[s + 1] + lower.rowStart[1];
+
+			JoinRows(allRuns, aBegin, aEnd, bBegin, bEnd);
+		}
+
+		// Sum moments per root
+		blobs.clear();
+		blobIndex.assign(allRuns.size(), -1);
+
+		for (size_t i = 0; i < allRuns.size(); i++)
+		{
+			unsigned int root = FindRoot(allRuns, static_cast<unsigned int>(i));
+			const Run & run = allRuns[i];
+
+			if (blobIndex[root] < 0)
+			{
+				Blob blob;
+				blob.centroidX = 0.0;
+				blob.centroidY = 0.0;
+				blob.area = 0;
+				blob.sumIntensity = 0.0;
+				blob.minX = run.xStart;
+				blob.maxX = run.xEnd - 1;
+				blob.minY = run.y;
+				blob.maxY = run.y;
+
+				blobIndex[root] = static_cast<int>(blobs.size());
+				blobs.push_back(blob);
+			}
+
+			Blob & blob = blobs[blobIndex[root]];
+			blob.area += run.xEnd - run.xStart;
+			blob.sumIntensity += run.sumW;
+			blob.centroidX += run.sumWX;
+			blob.centroidY += run.sumW * run.y;
+			blob.minX = std::min(blob.minX, run.xStart);
+			blob.maxX = std::max(blob.maxX, run.xEnd - 1);
+			blob.minY = std::min(blob.minY, run.y);
+			blob.maxY = std::max(blob.maxY, run.y);
+		}
+
+		// Normalize and filter
+		size_t numKept = 0;
+		for (size_t i = 0; i < blobs.size(); i++)
+		{
+			Blob blob = blobs[i];
+
+			if (blob.area < m_params.minArea || blob.area > m_params.maxArea || blob.sumIntensity <= 0.0)
+			{
+				continue;
+			}
+
+			blob.centroidX /= blob.sumIntensity;
+			blob.centroidY /= blob.sumIntensity;
+
+			blobs[numKept++] = blob;
+		}
+		blobs.resize(numKept);
+	}
+
+	StripeWorkerPool & m_pool;
+	BlobTrackerParams m_params;
+	BlobTrackerStats m_stats;
+	std::vector<Blob> m_blobs;
+	unsigned int m_framesSinceFull;
+
+	MergeScratch m_scratch;
+};
+
+#endif // ABHI_BLOB_TRACKER_H
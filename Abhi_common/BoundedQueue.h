@@ -0,0 +1,125 @@
+//
+// BoundedQueue.h
+//
+// A fixed-capacity queue for handing frames from one thread to another.
+// TryPush() never blocks: when the queue is full it fails and the caller
+// decides what to drop, the way a camera drops frames when no buffer is
+// free. Pop() waits up to a timeout. The queue keeps its high-water mark so
+// growth can be watched over long runs.
+//
+
+#ifndef ABHI_BOUNDED_QUEUE_H
+#define ABHI_BOUNDED_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+template <typename T>
+class BoundedQueue
+{
+public:
+
+	BoundedQueue(size_t capacity)
+		: m_capacity(capacity), m_highWaterMark(0), m_closed(false)
+	{
+	}
+
+	size_t GetCapacity() const { return m_capacity; }
+
+	// Adds an item; returns false if the queue is full or closed
+	bool TryPush(const T & item)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_closed || m_items.size() >= m_capacity)
+			{
+				return false;
+			}
+
+			m_items.push_back(item);
+			if (m_items.size() > m_highWaterMark)
+			{
+				m_highWaterMark = m_items.size();
+			}
+		}
+
+		m_itemAvailable.notify_one();
+		return true;
+	}
+
+	// Takes the oldest item, waiting up to timeoutMs. Returns false on
+	// timeout, or once the queue is closed and empty.
+	bool Pop(T & item, unsigned int timeoutMs)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+		while (m_items.empty() && !m_closed)
+		{
+			if (m_itemAvailable.wait_until(lock, deadline) == std::cv_status::timeout)
+			{
+				break;
+			}
+		}
+
+		if (m_items.empty())
+		{
+			return false;
+		}
+
+		item = m_items.front();
+		m_items.pop_front();
+		return true;
+	}
+
+	// Takes the oldest item without waiting
+	bool TryPop(T & item)
+	{
+		return Pop(item, 0);
+	}
+
+	// Wakes all waiting consumers; later pushes fail
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_closed = true;
+		}
+
+		m_itemAvailable.notify_all();
+	}
+
+	size_t Size() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_items.size();
+	}
+
+	// Largest size seen since construction or the last reset
+	size_t GetHighWaterMark() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_highWaterMark;
+	}
+
+	void ResetHighWaterMark()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_highWaterMark = m_items.size();
+	}
+
+private:
+
+	const size_t m_capacity;
+	std::deque<T> m_items;
+	size_t m_highWaterMark;
+	bool m_closed;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_itemAvailable;
+};
+
+#endif // ABHI_BOUNDED_QUEUE_H
@@ -0,0 +1,225 @@
+//
+// CoalescedNodeNotifier.h
+//
+// Nodemap callbacks registered with Register() run synchronously inside the
+// setter and fire for every intermediate change. This class registers a
+// callback that does nothing but mark the node as dirty. A worker thread wakes
+// once per interval, reads the latest value of every node that changed since
+// the previous wake-up, and delivers them to a handler as one batch.
+//
+// A node that changes many times within one interval is reported once, with
+// its most recent value. The handler runs on the worker thread, never on the
+// thread that called the setter.
+//
+
+#ifndef ABHI_COALESCED_NODE_NOTIFIER_H
+#define ABHI_COALESCED_NODE_NOTIFIER_H
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One entry of a coalesced batch
+struct NodeChange
+{
+	std::string featureName;
+	std::string value;
+	unsigned int updateCount;	// Number of callbacks merged into this entry
+};
+
+typedef std::vector<NodeChange> NodeChangeBatch;
+
+class CoalescedNodeNotifier
+{
+public:
+
+	typedef std::function<void(const NodeChangeBatch &)> BatchHandler;
+
+	CoalescedNodeNotifier(unsigned int intervalMs = 100)
+		: m_intervalMs(intervalMs), m_running(false), m_callbackCount(0), m_batchCount(0)
+	{
+	}
+
+	~CoalescedNodeNotifier()
+	{
+		Stop();
+		Unwatch();
+	}
+
+	void SetHandler(BatchHandler handler)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_handler = handler;
+	}
+
+	// Registers the dirty-marking callback on a feature. Returns false if the
+	// node does not exist.
+	bool Watch(Spinnaker::GenApi::INodeMap & nodeMap, const char* featureName)
+	{
+		using namespace Spinnaker::GenApi;
+
+		CNodePtr ptrNode = nodeMap.GetNode(featureName);
+		if (!IsAvailable(ptrNode))
+		{
+			return false;
+		}
+
+		m_callbacks.push_back(Register(ptrNode, *this, &CoalescedNodeNotifier::OnNodeUpdate));
+
+		return true;
+	}
+
+	// Deregisters all callbacks. Must be called before the camera is
+	// deinitialized; the destructor does it as well.
+	void Unwatch()
+	{
+		for (size_t i = 0; i < m_callbacks.size(); i++)
+		{
+			Spinnaker::GenApi::Deregister(m_callbacks[i]);
+		}
+		m_callbacks.clear();
+	}
+
+	void Start()
+	{
+		if (m_running)
+		{
+			return;
+		}
+
+		m_running = true;
+		m_worker = std::thread(&CoalescedNodeNotifier::WorkerLoop, this);
+	}
+
+	// Stops the worker after delivering whatever is still pending
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_running)
+			{
+				return;
+			}
+			m_running = false;
+		}
+
+		m_wakeUp.notify_one();
+		m_worker.join();
+	}
+
+	// Callback registered on every watched node; runs inside the setter, so it
+	// only records the node.
+	void OnNodeUpdate(Spinnaker::GenApi::INode* node)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_dirtyNodes.insert(node);
+		m_updateCounts[node]++;
+		m_callbackCount++;
+	}
+
+	unsigned long long GetCallbackCount()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_callbackCount;
+	}
+
+	unsigned long long GetBatchCount()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_batchCount;
+	}
+
+private:
+
+	void WorkerLoop()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		while (m_running || !m_dirtyNodes.empty())
+		{
+			if (m_running)
+			{
+				m_wakeUp.wait_for(lock, std::chrono::milliseconds(m_intervalMs));
+			}
+
+			if (m_dirtyNodes.empty())
+			{
+				continue;
+			}
+
+			// Take the dirty set so the callback can keep filling a new one
+			std::set<Spinnaker::GenApi::INode*> dirtyNodes;
+			dirtyNodes.swap(m_dirtyNodes);
+
+			std::map<Spinnaker::GenApi::INode*, unsigned int> updateCounts;
+			updateCounts.swap(m_updateCounts);
+
+			BatchHandler handler = m_handler;
+			m_batchCount++;
+
+			lock.unlock();
+
+			DeliverBatch(dirtyNodes, updateCounts, handler);
+
+			lock.lock();
+		}
+	}
+
+	// Reads the latest values outside the lock and hands them to the handler
+	static void DeliverBatch(const std::set<Spinnaker::GenApi::INode*> & dirtyNodes,
+		std::map<Spinnaker::GenApi::INode*, unsigned int> & updateCounts, BatchHandler & handler)
+	{
+		using namespace Spinnaker::GenApi;
+
+		NodeChangeBatch batch;
+
+		std::set<INode*>::const_iterator it;
+		for (it = dirtyNodes.begin(); it != dirtyNodes.end(); ++it)
+		{
+			NodeChange change;
+			change.featureName = (*it)->GetName().c_str();
+			change.updateCount = updateCounts[*it];
+
+			try
+			{
+				CValuePtr ptrValue = *it;
+				change.value = IsReadable(ptrValue) ? ptrValue->ToString().c_str() : "Node not readable";
+			}
+			catch (Spinnaker::Exception &e)
+			{
+				change.value = std::string("Error: ") + e.what();
+			}
+
+			batch.push_back(change);
+		}
+
+		if (handler)
+		{
+			handler(batch);
+		}
+	}
+
+	unsigned int m_intervalMs;
+	bool m_running;
+	std::thread m_worker;
+	std::mutex m_mutex;
+	std::condition_variable m_wakeUp;
+	BatchHandler m_handler;
+
+	std::vector<Spinnaker::GenApi::CallbackHandleType> m_callbacks;
+	std::set<Spinnaker::GenApi::INode*> m_dirtyNodes;
+	std::map<Spinnaker::GenApi::INode*, unsigned int> m_updateCounts;
+	unsigned long long m_callbackCount;
+	unsigned long long m_batchCount;
+};
+
+#endif // ABHI_COALESCED_NODE_NOTIFIER_H
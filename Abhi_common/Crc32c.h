@@ -0,0 +1,163 @@
+//
+// Crc32c.h
+//
+// CRC-32C (Castagnoli), the checksum used by iSCSI, ext4 and SCTP. On x86
+// CPUs with SSE4.2 the crc32 instruction computes it 8 bytes at a time;
+// elsewhere a portable slicing-by-8 version with eight lookup tables is
+// used. Crc32c() picks one at run time, so no -msse4.2 is needed.
+//
+
+#ifndef ABHI_CRC32C_H
+#define ABHI_CRC32C_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#endif
+
+// Lookup tables, built on first use
+class Crc32cTables
+{
+public:
+
+	static const Crc32cTables & Get()
+	{
+		static const Crc32cTables tables;
+		return tables;
+	}
+
+	uint32_t table[8][256];
+
+private:
+
+	Crc32cTables()
+	{
+		const uint32_t polynomial = 0x82F63B78u;	// reflected 0x1EDC6F41
+
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t crc = i;
+			for (unsigned int bit = 0; bit < 8; bit++)
+			{
+				crc = (crc & 1) ? (crc >> 1) ^ polynomial : crc >> 1;
+			}
+			table[0][i] = crc;
+		}
+
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			for (unsigned int slice = 1; slice < 8; slice++)
+			{
+				table[slice][i] = (table[slice - 1][i] >> 8) ^ table[0][table[slice - 1][i] & 0xFF];
+			}
+		}
+	}
+};
+
+// Continues a CRC-32C over more data with lookup tables; start with crc = 0
+inline uint32_t Crc32cPortable(const void* data, size_t size, uint32_t crc = 0)
+{
+	const uint32_t (&table)[8][256] = Crc32cTables::Get().table;
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	crc = ~crc;
+
+	while (size >= 8)
+	{
+		uint32_t low;
+		uint32_t high;
+		memcpy(&low, bytes, 4);
+		memcpy(&high, bytes + 4, 4);
+		low ^= crc;
+
+		crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+			table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+
+		bytes += 8;
+		size -= 8;
+	}
+
+	while (size > 0)
+	{
+		crc = (crc >> 8) ^ table[0][(crc ^ *bytes) & 0xFF];
+		bytes++;
+		size--;
+	}
+
+	return ~crc;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Continues a CRC-32C over more data with the SSE4.2 crc32 instruction;
+// only call it when HasHardwareCrc32c() is true
+__attribute__((target("sse4.2")))
+inline uint32_t Crc32cHardware(const void* data, size_t size, uint32_t crc = 0)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	crc = ~crc;
+
+#if defined(__x86_64__)
+	uint64_t crc64 = crc;
+	while (size >= 8)
+	{
+		uint64_t value;
+		memcpy(&value, bytes, 8);
+		crc64 = _mm_crc32_u64(crc64, value);
+		bytes += 8;
+		size -= 8;
+	}
+	crc = static_cast<uint32_t>(crc64);
+#endif
+
+	while (size >= 4)
+	{
+		uint32_t value;
+		memcpy(&value, bytes, 4);
+		crc = _mm_crc32_u32(crc, value);
+		bytes += 4;
+		size -= 4;
+	}
+
+	while (size > 0)
+	{
+		crc = _mm_crc32_u8(crc, *bytes);
+		bytes++;
+		size--;
+	}
+
+	return ~crc;
+}
+
+inline bool HasHardwareCrc32c()
+{
+	static const bool hasSse42 = __builtin_cpu_supports("sse4.2");
+	return hasSse42;
+}
+
+#else
+
+inline bool HasHardwareCrc32c()
+{
+	return false;
+}
+
+#endif
+
+// Continues a CRC-32C over more data; start with crc = 0
+inline uint32_t Crc32c(const void* data, size_t size, uint32_t crc = 0)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	if (HasHardwareCrc32c())
+	{
+		return Crc32cHardware(data, size, crc);
+	}
+#endif
+
+	return Crc32cPortable(data, size, crc);
+}
+
+#endif // ABHI_CRC32C_H
@@ -0,0 +1,311 @@
+//
+// DeviceHealthSampler.h
+//
+// Polls device and transport-layer nodes (temperature, link errors, lost
+// frames, ...) on a background thread at a low rate and publishes the values
+// to a MetricsRegistry. Node handles are looked up once when a camera is
+// added, so each sample is only a value read.
+//
+// Each node may carry alarm thresholds. Level alarms fire when the value
+// leaves [alarmLow, alarmHigh] and clear when it returns; counter alarms fire
+// whenever the value increases between two samples (useful for error and drop
+// counters). Alarms are reported to a handler on the sampler thread, never on
+// an acquisition thread.
+//
+
+#ifndef ABHI_DEVICE_HEALTH_SAMPLER_H
+#define ABHI_DEVICE_HEALTH_SAMPLER_H
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MetricsRegistry.h"
+
+// Nodemap a health node is read from
+enum healthNodeSource
+{
+	DEVICE_NODEMAP,
+	TL_DEVICE_NODEMAP,
+	TL_STREAM_NODEMAP
+};
+
+// Description of one node to sample
+struct HealthNodeSpec
+{
+	HealthNodeSpec(healthNodeSource nodeSource, const std::string & name,
+		double low = -std::numeric_limits<double>::infinity(),
+		double high = std::numeric_limits<double>::infinity(),
+		bool increaseIsAlarm = false)
+		: source(nodeSource), featureName(name), alarmLow(low), alarmHigh(high),
+		alarmOnIncrease(increaseIsAlarm)
+	{
+	}
+
+	healthNodeSource source;
+	std::string featureName;
+	double alarmLow;
+	double alarmHigh;
+	bool alarmOnIncrease;
+};
+
+// Alarm raised or cleared by the sampler
+struct HealthAlarm
+{
+	std::string cameraLabel;
+	std::string featureName;
+	double value;
+	double previousValue;
+	bool raised;
+};
+
+// This function returns the nodes sampled when no explicit list is given.
+// Nodes a camera does not have are skipped when the camera is added.
+inline std::vector<HealthNodeSpec> DefaultHealthNodes()
+{
+	const double inf = std::numeric_limits<double>::infinity();
+
+	std::vector<HealthNodeSpec> specs;
+
+	specs.push_back(HealthNodeSpec(DEVICE_NODEMAP, "DeviceTemperature", -inf, 70.0));
+	specs.push_back(HealthNodeSpec(DEVICE_NODEMAP, "LinkErrorCount", -inf, inf, true));
+	specs.push_back(HealthNodeSpec(TL_STREAM_NODEMAP, "StreamLostFrameCount", -inf, inf, true));
+	specs.push_back(HealthNodeSpec(TL_STREAM_NODEMAP, "StreamFailedBufferCount", -inf, inf, true));
+	specs.push_back(HealthNodeSpec(TL_STREAM_NODEMAP, "StreamBufferUnderrunCount", -inf, inf, true));
+
+	return specs;
+}
+
+class DeviceHealthSampler
+{
+public:
+
+	typedef std::function<void(const HealthAlarm &)> AlarmHandler;
+
+	DeviceHealthSampler(MetricsRegistry & metrics, unsigned int periodMs = 1000)
+		: m_metrics(metrics), m_periodMs(periodMs), m_running(false), m_sampleCount(0)
+	{
+		m_alarmHandler = PrintAlarm;
+	}
+
+	~DeviceHealthSampler()
+	{
+		Stop();
+	}
+
+	void SetAlarmHandler(AlarmHandler handler)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_alarmHandler = handler;
+	}
+
+	// Looks up the node handles for a camera. The camera must be initialized
+	// and must stay initialized until Stop() returns. Returns the number of
+	// nodes that will be sampled.
+	unsigned int AddCamera(Spinnaker::CameraPtr pCam, const std::string & label,
+		const std::vector<HealthNodeSpec> & specs = DefaultHealthNodes())
+	{
+		using namespace Spinnaker::GenApi;
+
+		unsigned int numFound = 0;
+
+		for (size_t i = 0; i < specs.size(); i++)
+		{
+			INodeMap & nodeMap = (specs[i].source == DEVICE_NODEMAP) ? pCam->GetNodeMap() :
+				(specs[i].source == TL_DEVICE_NODEMAP) ? pCam->GetTLDeviceNodeMap() : pCam->GetTLStreamNodeMap();
+
+			CachedNode cached(specs[i]);
+			cached.cameraLabel = label;
+			cached.metricName = label + "." + specs[i].featureName;
+
+			CNodePtr ptrNode = nodeMap.GetNode(specs[i].featureName.c_str());
+			if (!IsAvailable(ptrNode) || !IsReadable(ptrNode))
+			{
+				std::cout << "Health node " << specs[i].featureName << " not available on " << label << "; skipping..." << std::endl;
+				continue;
+			}
+
+			if (ptrNode->GetPrincipalInterfaceType() == intfIFloat)
+			{
+				cached.ptrFloat = ptrNode;
+			}
+			else if (ptrNode->GetPrincipalInterfaceType() == intfIInteger)
+			{
+				cached.ptrInteger = ptrNode;
+			}
+			else
+			{
+				std::cout << "Health node " << specs[i].featureName << " is not numeric; skipping..." << std::endl;
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_nodes.push_back(cached);
+			numFound++;
+		}
+
+		return numFound;
+	}
+
+	void Start()
+	{
+		if (m_running)
+		{
+			return;
+		}
+
+		m_running = true;
+		m_worker = std::thread(&DeviceHealthSampler::WorkerLoop, this);
+	}
+
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_running)
+			{
+				return;
+			}
+			m_running = false;
+		}
+
+		m_wakeUp.notify_one();
+		m_worker.join();
+	}
+
+	unsigned long long GetSampleCount()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_sampleCount;
+	}
+
+	static void PrintAlarm(const HealthAlarm & alarm)
+	{
+		std::cout << (alarm.raised ? "ALARM: " : "Alarm cleared: ") << alarm.cameraLabel << " "
+			<< alarm.featureName << " = " << alarm.value << " (was " << alarm.previousValue << ")" << std::endl;
+	}
+
+private:
+
+	struct CachedNode
+	{
+		CachedNode(const HealthNodeSpec & nodeSpec)
+			: spec(nodeSpec), hasValue(false), lastValue(0.0), inAlarm(false)
+		{
+		}
+
+		HealthNodeSpec spec;
+		std::string cameraLabel;
+		std::string metricName;
+		Spinnaker::GenApi::CFloatPtr ptrFloat;
+		Spinnaker::GenApi::CIntegerPtr ptrInteger;
+		bool hasValue;
+		double lastValue;
+		bool inAlarm;
+	};
+
+	void WorkerLoop()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		while (m_running)
+		{
+			std::vector<HealthAlarm> alarms;
+
+			for (size_t i = 0; i < m_nodes.size(); i++)
+			{
+				SampleNode(m_nodes[i], alarms);
+			}
+
+			m_sampleCount++;
+			AlarmHandler handler = m_alarmHandler;
+
+			lock.unlock();
+
+			for (size_t i = 0; i < alarms.size() && handler; i++)
+			{
+				handler(alarms[i]);
+			}
+
+			lock.lock();
+
+			if (m_running)
+			{
+				m_wakeUp.wait_for(lock, std::chrono::milliseconds(m_periodMs));
+			}
+		}
+	}
+
+	// Reads one node, publishes it and checks its thresholds
+	void SampleNode(CachedNode & node, std::vector<HealthAlarm> & alarms)
+	{
+		double value = 0.0;
+
+		try
+		{
+			value = node.ptrFloat.IsValid() ? node.ptrFloat->GetValue() :
+				static_cast<double>(node.ptrInteger->GetValue());
+		}
+		catch (Spinnaker::Exception &)
+		{
+			m_metrics.AddCounter(node.metricName + ".ReadErrors");
+			return;
+		}
+
+		m_metrics.SetGauge(node.metricName, value);
+
+		HealthAlarm alarm;
+		alarm.cameraLabel = node.cameraLabel;
+		alarm.featureName = node.spec.featureName;
+		alarm.value = value;
+		alarm.previousValue = node.hasValue ? node.lastValue : value;
+
+		if (node.spec.alarmOnIncrease)
+		{
+			if (node.hasValue && value > node.lastValue)
+			{
+				alarm.raised = true;
+				alarms.push_back(alarm);
+				m_metrics.AddCounter(node.metricName + ".Alarms");
+			}
+		}
+		else
+		{
+			bool outOfRange = value < node.spec.alarmLow || value > node.spec.alarmHigh;
+
+			if (outOfRange != node.inAlarm)
+			{
+				node.inAlarm = outOfRange;
+				alarm.raised = outOfRange;
+				alarms.push_back(alarm);
+
+				if (outOfRange)
+				{
+					m_metrics.AddCounter(node.metricName + ".Alarms");
+				}
+			}
+		}
+
+		node.lastValue = value;
+		node.hasValue = true;
+	}
+
+	MetricsRegistry & m_metrics;
+	unsigned int m_periodMs;
+	bool m_running;
+	std::thread m_worker;
+	std::mutex m_mutex;
+	std::condition_variable m_wakeUp;
+	AlarmHandler m_alarmHandler;
+	std::vector<CachedNode> m_nodes;
+	unsigned long long m_sampleCount;
+};
+
+#endif // ABHI_DEVICE_HEALTH_SAMPLER_H
@@ -0,0 +1,499 @@
+//
+// FrameCatalog.h
+//
+// A compact on-disk index of recorded frames, one file per camera, so the
+// frames around a point in time can be found without scanning the recording
+// directory.
+//
+// A catalog file is a 64-byte header followed by fixed-size records in the
+// order they were recorded, sorted by host timestamp. The record count
+// follows from the file size, so appending a record is the only write and a
+// reader can pick up new records while recording goes on. A partial record at
+// the end (after a crash) is ignored by readers and cut off by the writer.
+//
+// Readers map the file and use binary search; lookups do not read more than
+// a few pages of even very long recordings.
+//
+
+#ifndef ABHI_FRAME_CATALOG_H
+#define ABHI_FRAME_CATALOG_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// One recorded frame. fileNumber and offset locate the frame: for one file
+// per frame (Cam-<serial>-<n>.jpg) fileNumber is n and offset is 0; for
+// container files they are the part number and byte offset.
+struct FrameCatalogRecord
+{
+	uint64_t hostTimestampNs;		// wall clock, ns since the epoch
+	uint64_t cameraTimestampNs;		// image timestamp from the camera
+	uint64_t frameId;
+	uint64_t fileNumber;
+	uint64_t offset;
+};
+
+// File header; serial identifies the camera
+struct FrameCatalogHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+	char serial[48];
+};
+
+const char k_frameCatalogMagic[8] = { 'A', 'B', 'H', 'I', 'C', 'A', 'T', '1' };
+const uint32_t k_frameCatalogVersion = 1;
+
+// This helper returns the catalog path of a camera in a recording directory.
+inline std::string GetFrameCatalogPath(const std::string & directory, const std::string & serial)
+{
+	return directory + "/Cam-" + serial + ".idx";
+}
+
+// Appends records to the catalog of one camera. Records are buffered and
+// written in batches; Flush() makes them visible to readers.
+class FrameCatalogWriter
+{
+public:
+
+	FrameCatalogWriter(unsigned int flushInterval = 64)
+		: m_fd(-1), m_flushInterval(flushInterval), m_lastHostTimestampNs(0)
+	{
+	}
+
+	~FrameCatalogWriter()
+	{
+		Close();
+	}
+
+	// Creates the catalog, or opens an existing one of the same camera to
+	// append to it. Returns -1 on error.
+	int Open(const std::string & path, const std::string & serial)
+	{
+		Close();
+
+		m_fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+		if (m_fd < 0)
+		{
+			return -1;
+		}
+
+		struct stat fileStat;
+		if (fstat(m_fd, &fileStat) != 0)
+		{
+			Close();
+			return -1;
+		}
+
+		FrameCatalogHeader header;
+
+		if (fileStat.st_size < static_cast<off_t>(sizeof(header)))
+		{
+			// New catalog
+			memset(&header, 0, sizeof(header));
+			memcpy(header.magic, k_frameCatalogMagic, sizeof(header.magic));
+			header.version = k_frameCatalogVersion;
+			header.recordSize = sizeof(FrameCatalogRecord);
+			strncpy(header.serial, serial.c_str(), sizeof(header.serial) - 1);
+
+			if (ftruncate(m_fd, 0) != 0 || pwrite(m_fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+			{
+				Close();
+				return -1;
+			}
+
+			m_lastHostTimestampNs = 0;
+			return 0;
+		}
+
+		// Existing catalog: check it belongs to this camera and drop a
+		// partial record left by a crash
+		if (pread(m_fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+			memcmp(header.magic, k_frameCatalogMagic, sizeof(header.magic)) != 0 ||
+			header.recordSize != sizeof(FrameCatalogRecord) ||
+			strncmp(header.serial, serial.c_str(), sizeof(header.serial)) != 0)
+		{
+			Close();
+			return -1;
+		}
+
+		const off_t numRecords = (fileStat.st_size - static_cast<off_t>(sizeof(header))) / static_cast<off_t>(sizeof(FrameCatalogRecord));
+		const off_t end = static_cast<off_t>(sizeof(header)) + numRecords * static_cast<off_t>(sizeof(FrameCatalogRecord));
+
+		if (end != fileStat.st_size && ftruncate(m_fd, end) != 0)
+		{
+			Close();
+			return -1;
+		}
+
+		m_lastHostTimestampNs = 0;
+		if (numRecords > 0)
+		{
+			FrameCatalogRecord last;
+			if (pread(m_fd, &last, sizeof(last), end - static_cast<off_t>(sizeof(last))) == static_cast<ssize_t>(sizeof(last)))
+			{
+				m_lastHostTimestampNs = last.hostTimestampNs;
+			}
+		}
+
+		return 0;
+	}
+
+	bool IsOpen() const
+	{
+		return m_fd >= 0;
+	}
+
+	// Queues a record. A host timestamp earlier than the previous one (the
+	// wall clock was set back) is raised to it to keep the catalog sorted.
+	int Append(FrameCatalogRecord record)
+	{
+		if (m_fd < 0)
+		{
+			return -1;
+		}
+
+		if (record.hostTimestampNs < m_lastHostTimestampNs)
+		{
+			record.hostTimestampNs = m_lastHostTimestampNs;
+		}
+		m_lastHostTimestampNs = record.hostTimestampNs;
+
+		m_pending.push_back(record);
+
+		if (m_pending.size() >= m_flushInterval)
+		{
+			return Flush();
+		}
+
+		return 0;
+	}
+
+	// Writes queued records at the end of the file
+	int Flush()
+	{
+		if (m_fd < 0)
+		{
+			return -1;
+		}
+
+		if (m_pending.empty())
+		{
+			return 0;
+		}
+
+		const off_t end = lseek(m_fd, 0, SEEK_END);
+		const size_t size = m_pending.size() * sizeof(FrameCatalogRecord);
+
+		if (end < 0 || pwrite(m_fd, &m_pending[0], size, end) != static_cast<ssize_t>(size))
+		{
+			return -1;
+		}
+
+		m_pending.clear();
+		return 0;
+	}
+
+	void Close()
+	{
+		if (m_fd >= 0)
+		{
+			Flush();
+			close(m_fd);
+			m_fd = -1;
+		}
+		m_pending.clear();
+	}
+
+private:
+
+	int m_fd;
+	unsigned int m_flushInterval;
+	uint64_t m_lastHostTimestampNs;
+	std::vector<FrameCatalogRecord> m_pending;
+};
+
+// Searches the catalog of one camera through a read-only mapping
+class FrameCatalogReader
+{
+public:
+
+	FrameCatalogReader()
+		: m_fd(-1), m_mapping(NULL), m_mappedSize(0), m_records(NULL), m_numRecords(0)
+	{
+		memset(&m_header, 0, sizeof(m_header));
+	}
+
+	~FrameCatalogReader()
+	{
+		Close();
+	}
+
+	// Opens and maps a catalog. Returns -1 if it is missing or not a catalog.
+	int Open(const std::string & path)
+	{
+		Close();
+
+		m_fd = open(path.c_str(), O_RDONLY);
+		if (m_fd < 0)
+		{
+			return -1;
+		}
+
+		if (Refresh() != 0 || m_mappedSize < sizeof(FrameCatalogHeader))
+		{
+			Close();
+			return -1;
+		}
+
+		memcpy(&m_header, m_mapping, sizeof(m_header));
+
+		if (memcmp(m_header.magic, k_frameCatalogMagic, sizeof(m_header.magic)) != 0 ||
+			m_header.recordSize != sizeof(FrameCatalogRecord))
+		{
+			Close();
+			return -1;
+		}
+
+		return 0;
+	}
+
+	// Maps records appended since the last call, e.g. while recording
+	int Refresh()
+	{
+		if (m_fd < 0)
+		{
+			return -1;
+		}
+
+		struct stat fileStat;
+		if (fstat(m_fd, &fileStat) != 0)
+		{
+			return -1;
+		}
+
+		const size_t size = static_cast<size_t>(fileStat.st_size);
+		if (size == m_mappedSize)
+		{
+			return 0;
+		}
+
+		Unmap();
+
+		if (size == 0)
+		{
+			return 0;
+		}
+
+		void* mapping = mmap(NULL, size, PROT_READ, MAP_SHARED, m_fd, 0);
+		if (mapping == MAP_FAILED)
+		{
+			return -1;
+		}
+
+		m_mapping = mapping;
+		m_mappedSize = size;
+
+		if (size >= sizeof(FrameCatalogHeader))
+		{
+			m_records = reinterpret_cast<const FrameCatalogRecord*>(static_cast<const char*>(mapping) + sizeof(FrameCatalogHeader));
+			m_numRecords = (size - sizeof(FrameCatalogHeader)) / sizeof(FrameCatalogRecord);
+		}
+
+		return 0;
+	}
+
+	void Close()
+	{
+		Unmap();
+
+		if (m_fd >= 0)
+		{
+			close(m_fd);
+			m_fd = -1;
+		}
+	}
+
+	std::string GetSerial() const
+	{
+		return std::string(m_header.serial, strnlen(m_header.serial, sizeof(m_header.serial)));
+	}
+
+	size_t GetNumRecords() const { return m_numRecords; }
+	const FrameCatalogRecord & GetRecord(size_t index) const { return m_records[index]; }
+
+	// Index of the first record at or after the given time
+	size_t LowerBound(uint64_t hostTimestampNs) const
+	{
+		const FrameCatalogRecord* end = m_records + m_numRecords;
+		const FrameCatalogRecord* found = std::lower_bound(m_records, end, hostTimestampNs, CompareTimestamp);
+		return static_cast<size_t>(found - m_records);
+	}
+
+	// Appends all records with a host timestamp in [beginNs, endNs)
+	void FindRange(uint64_t beginNs, uint64_t endNs, std::vector<FrameCatalogRecord> & records) const
+	{
+		for (size_t i = LowerBound(beginNs); i < m_numRecords && m_records[i].hostTimestampNs < endNs; i++)
+		{
+			records.push_back(m_records[i]);
+		}
+	}
+
+	// Finds the record closest in time. Returns false if the catalog is empty.
+	bool FindNearest(uint64_t hostTimestampNs, FrameCatalogRecord & record) const
+	{
+		if (m_numRecords == 0)
+		{
+			return false;
+		}
+
+		size_t index = LowerBound(hostTimestampNs);
+
+		if (index == m_numRecords ||
+			(index > 0 && hostTimestampNs - m_records[index - 1].hostTimestampNs < m_records[index].hostTimestampNs - hostTimestampNs))
+		{
+			index--;
+		}
+
+		record = m_records[index];
+		return true;
+	}
+
+private:
+
+	static bool CompareTimestamp(const FrameCatalogRecord & record, uint64_t hostTimestampNs)
+	{
+		return record.hostTimestampNs < hostTimestampNs;
+	}
+
+	void Unmap()
+	{
+		if (m_mapping != NULL)
+		{
+			munmap(m_mapping, m_mappedSize);
+			m_mapping = NULL;
+		}
+		m_mappedSize = 0;
+		m_records = NULL;
+		m_numRecords = 0;
+	}
+
+	int m_fd;
+	void* m_mapping;
+	size_t m_mappedSize;
+	FrameCatalogHeader m_header;
+	const FrameCatalogRecord* m_records;
+	size_t m_numRecords;
+};
+
+// The catalogs of all cameras in a recording directory, for lookups across
+// cameras
+class FrameCatalogSet
+{
+public:
+
+	~FrameCatalogSet()
+	{
+		Close();
+	}
+
+	// Opens every Cam-*.idx in the directory. Returns the number opened, or
+	// -1 if the directory cannot be read.
+	int Open(const std::string & directory)
+	{
+		Close();
+
+		DIR* dir = opendir(directory.c_str());
+		if (dir == NULL)
+		{
+			return -1;
+		}
+
+		std::vector<std::string> names;
+		struct dirent* entry;
+		while ((entry = readdir(dir)) != NULL)
+		{
+			const std::string name = entry->d_name;
+			if (name.compare(0, 4, "Cam-") == 0 && name.size() > 8 && name.compare(name.size() - 4, 4, ".idx") == 0)
+			{
+				names.push_back(name);
+			}
+		}
+		closedir(dir);
+
+		std::sort(names.begin(), names.end());
+
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			FrameCatalogReader* reader = new FrameCatalogReader();
+			if (reader->Open(directory + "/" + names[i]) == 0)
+			{
+				m_readers.push_back(reader);
+			}
+			else
+			{
+				delete reader;
+			}
+		}
+
+		return static_cast<int>(m_readers.size());
+	}
+
+	void Refresh()
+	{
+		for (size_t i = 0; i < m_readers.size(); i++)
+		{
+			m_readers[i]->Refresh();
+		}
+	}
+
+	void Close()
+	{
+		for (size_t i = 0; i < m_readers.size(); i++)
+		{
+			delete m_readers[i];
+		}
+		m_readers.clear();
+	}
+
+	size_t GetNumCameras() const { return m_readers.size(); }
+	const FrameCatalogReader & GetCamera(size_t index) const { return *m_readers[index]; }
+
+	// Nearest frame of every camera; found[i] is false for an empty catalog
+	void FindNearest(uint64_t hostTimestampNs, std::vector<FrameCatalogRecord> & records, std::vector<bool> & found) const
+	{
+		records.assign(m_readers.size(), FrameCatalogRecord());
+		found.assign(m_readers.size(), false);
+
+		for (size_t i = 0; i < m_readers.size(); i++)
+		{
+			found[i] = m_readers[i]->FindNearest(hostTimestampNs, records[i]);
+		}
+	}
+
+	// Frames of every camera in [beginNs, endNs)
+	void FindRange(uint64_t beginNs, uint64_t endNs, std::vector<std::vector<FrameCatalogRecord> > & records) const
+	{
+		records.assign(m_readers.size(), std::vector<FrameCatalogRecord>());
+
+		for (size_t i = 0; i < m_readers.size(); i++)
+		{
+			m_readers[i]->FindRange(beginNs, endNs, records[i]);
+		}
+	}
+
+private:
+
+	std::vector<FrameCatalogReader*> m_readers;
+};
+
+#endif // ABHI_FRAME_CATALOG_H
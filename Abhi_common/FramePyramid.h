@@ -0,0 +1,193 @@
+//
+// FramePyramid.h
+//
+// Builds several 2:1 downscaled levels of a frame (preview, thumbnail, ...)
+// in one streaming pass, instead of one cv::resize() pass over the full
+// frame per output size.
+//
+// Level 0 is the frame itself; level n+1 is level n reduced 2:1 in both
+// directions by averaging 2x2 blocks. The pass walks the frame two rows at
+// a time: each pair of source rows gives one row of level 1, and as soon
+// as level n has two new rows they are reduced into level n+1 while still
+// in cache. The frame is read once; every further level only touches rows
+// that were just written. Mono rows are reduced 32 pixels at a time with
+// SSE2. An odd last row or column of a level is dropped.
+//
+// A consumer can be attached to each level. It is called with the finished
+// level at the end of Build(), so the display can take one level and the
+// thumbnail writer another.
+//
+
+#ifndef ABHI_FRAME_PYRAMID_H
+#define ABHI_FRAME_PYRAMID_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include <emmintrin.h>
+
+// A finished pyramid level; data stays valid until the next Build()
+struct PyramidLevel
+{
+	unsigned int level;
+	unsigned int width;
+	unsigned int height;
+	unsigned int channels;
+	size_t stride;
+	const uint8_t* data;
+};
+
+typedef std::function<void(const PyramidLevel &)> PyramidConsumer;
+
+// This helper is the scalar 2x2 reduction; a fixed channel count lets the
+// compiler unroll and vectorize the inner loop.
+template <unsigned int CHANNELS>
+inline void ReduceRows2x2Scalar(const uint8_t* top, const uint8_t* bottom, uint8_t* dst, unsigned int begin, unsigned int end)
+{
+	for (unsigned int x = begin; x < end; x++)
+	{
+		const uint8_t* a = top + 2 * x * CHANNELS;
+		const uint8_t* b = bottom + 2 * x * CHANNELS;
+
+		for (unsigned int c = 0; c < CHANNELS; c++)
+		{
+			dst[x * CHANNELS + c] = static_cast<uint8_t>((a[c] + a[c + CHANNELS] + b[c] + b[c + CHANNELS] + 2) >> 2);
+		}
+	}
+}
+
+// This helper reduces two rows of interleaved pixels to one row of half the
+// width, averaging 2x2 blocks with rounding. Mono8 and BGR8 rows are
+// supported.
+inline void ReduceRows2x2(const uint8_t* top, const uint8_t* bottom, uint8_t* dst, unsigned int dstWidth, unsigned int channels)
+{
+	if (channels == 3)
+	{
+		ReduceRows2x2Scalar<3>(top, bottom, dst, 0, dstWidth);
+		return;
+	}
+
+	const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+	const __m128i two = _mm_set1_epi16(2);
+
+	unsigned int x = 0;
+	for (; x + 16 <= dstWidth; x += 16)
+	{
+		__m128i sums[2];
+
+		for (unsigned int half = 0; half < 2; half++)
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 2 * x + 16 * half));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 2 * x + 16 * half));
+
+			// Even plus odd pixels of each row, as 16-bit lanes
+			const __m128i horizontalA = _mm_add_epi16(_mm_and_si128(a, lowBytes), _mm_srli_epi16(a, 8));
+			const __m128i horizontalB = _mm_add_epi16(_mm_and_si128(b, lowBytes), _mm_srli_epi16(b, 8));
+
+			sums[half] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(horizontalA, horizontalB), two), 2);
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(sums[0], sums[1]));
+	}
+
+	ReduceRows2x2Scalar<1>(top, bottom, dst, x, dstWidth);
+}
+
+class FramePyramid
+{
+public:
+
+	// numLevels counts the downscaled levels, so 3 gives 1/2, 1/4 and 1/8;
+	// channels is 1 (Mono8) or 3 (BGR8)
+	FramePyramid(unsigned int numLevels, unsigned int channels = 1)
+		: m_channels(channels), m_levels(numLevels + 1), m_buffers(numLevels + 1), m_consumers(numLevels + 1)
+	{
+	}
+
+	unsigned int GetNumLevels() const { return static_cast<unsigned int>(m_levels.size()) - 1; }
+
+	// Routes a level to a consumer; level 0 is the source frame
+	void SetConsumer(unsigned int level, const PyramidConsumer & consumer)
+	{
+		if (level < m_consumers.size())
+		{
+			m_consumers[level] = consumer;
+		}
+	}
+
+	const PyramidLevel & GetLevel(unsigned int level) const
+	{
+		return m_levels[level];
+	}
+
+	// Builds all levels from a frame, then calls the consumers
+	void Build(const uint8_t* data, unsigned int width, unsigned int height, size_t stride)
+	{
+		m_levels[0].level = 0;
+		m_levels[0].width = width;
+		m_levels[0].height = height;
+		m_levels[0].channels = m_channels;
+		m_levels[0].stride = stride;
+		m_levels[0].data = data;
+
+		for (size_t i = 1; i < m_levels.size(); i++)
+		{
+			PyramidLevel & level = m_levels[i];
+			level.level = static_cast<unsigned int>(i);
+			level.width = m_levels[i - 1].width / 2;
+			level.height = m_levels[i - 1].height / 2;
+			level.channels = m_channels;
+			level.stride = static_cast<size_t>(level.width) * m_channels;
+
+			m_buffers[i].resize(level.stride * level.height + 1);
+			level.data = &m_buffers[i][0];
+		}
+
+		// Each row of level 1 may complete a row of every level below it
+		const unsigned int numRows = m_levels.size() > 1 ? m_levels[1].height : 0;
+
+		for (unsigned int row = 0; row < numRows; row++)
+		{
+			ReduceRow(1, row);
+
+			unsigned int levelRow = row;
+			for (size_t i = 2; i < m_levels.size() && (levelRow & 1) == 1; i++)
+			{
+				levelRow /= 2;
+				if (levelRow >= m_levels[i].height)
+				{
+					break;
+				}
+				ReduceRow(static_cast<unsigned int>(i), levelRow);
+			}
+		}
+
+		for (size_t i = 0; i < m_levels.size(); i++)
+		{
+			if (m_consumers[i])
+			{
+				m_consumers[i](m_levels[i]);
+			}
+		}
+	}
+
+private:
+
+	// Writes one row of a level from two rows of the level above
+	void ReduceRow(unsigned int level, unsigned int row)
+	{
+		const PyramidLevel & source = m_levels[level - 1];
+		const uint8_t* top = source.data + 2 * static_cast<size_t>(row) * source.stride;
+
+		ReduceRows2x2(top, top + source.stride, &m_buffers[level][static_cast<size_t>(row) * m_levels[level].stride],
+			m_levels[level].width, m_channels);
+	}
+
+	unsigned int m_channels;
+	std::vector<PyramidLevel> m_levels;
+	std::vector<std::vector<uint8_t> > m_buffers;
+	std::vector<PyramidConsumer> m_consumers;
+};
+
+#endif // ABHI_FRAME_PYRAMID_H
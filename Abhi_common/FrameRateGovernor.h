@@ -0,0 +1,311 @@
+//
+// FrameRateGovernor.h
+//
+// Sets a camera's AcquisitionFrameRate from how fast its consumers actually
+// process frames, so the camera sends fewer frames that are all used
+// instead of free-running and having the host drop the surplus.
+//
+// Consumers report the time each frame kept them busy. Their capacity is
+// numConsumers / (smoothed busy time per frame), and the target rate is
+// that capacity times a headroom factor. With hysteresis:
+// - the rate is lowered at once when it is above the target by more than
+//   the band, or straight away by the dropped share whenever frames were
+//   dropped or the queue keeps growing;
+// - the rate is raised only after the target has stayed above it by more
+//   than the band for raiseHoldSeconds, and by at most raiseStep at a time,
+//   so a short lull in processing does not start an oscillation.
+//
+// FrameRateController holds the decisions and needs no camera;
+// FrameRateGovernor applies them through the camera's nodes. Cameras name
+// the enable node AcquisitionFrameRateEnable (GenICam SFNC) or, on older
+// firmware, AcquisitionFrameRateEnabled; both are handled.
+//
+
+#ifndef ABHI_FRAME_RATE_GOVERNOR_H
+#define ABHI_FRAME_RATE_GOVERNOR_H
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+struct FrameRateGovernorParams
+{
+	FrameRateGovernorParams()
+		: headroom(0.9), band(0.05), raiseStep(1.1), raiseHoldSeconds(2.0), smoothing(0.2), numConsumers(1)
+	{
+	}
+
+	double headroom;			// Target rate as a share of consumer capacity
+	double band;				// Relative difference ignored around the target
+	double raiseStep;			// Largest factor the rate is raised by per update
+	double raiseHoldSeconds;	// Time the target must stay higher before raising
+	double smoothing;			// Weight of a new busy-time sample in the average
+	unsigned int numConsumers;	// Threads processing this camera's frames
+};
+
+// The rate decisions, without a camera. Report*() may be called from the
+// consumer threads; Update() from one control thread.
+class FrameRateController
+{
+public:
+
+	FrameRateController(const FrameRateGovernorParams & params = FrameRateGovernorParams())
+		: m_params(params), m_minFrameRate(1.0), m_maxFrameRate(1000.0), m_frameRate(1000.0),
+		m_busySeconds(0.0), m_numConsumed(0), m_numDropped(0), m_lastQueueDepth(0), m_raiseSince(-1.0)
+	{
+	}
+
+	void SetLimits(double minFrameRate, double maxFrameRate)
+	{
+		m_minFrameRate = minFrameRate;
+		m_maxFrameRate = maxFrameRate;
+		m_frameRate = std::min(std::max(m_frameRate, minFrameRate), maxFrameRate);
+	}
+
+	// Starts from the given rate, e.g. what the camera free-runs at
+	void SetFrameRate(double frameRate)
+	{
+		m_frameRate = std::min(std::max(frameRate, m_minFrameRate), m_maxFrameRate);
+	}
+
+	double GetFrameRate() const { return m_frameRate; }
+
+	// Called by a consumer after each frame with the time it took
+	void ReportConsumed(double busySeconds)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		m_busySeconds = m_numConsumed == 0 ? busySeconds
+			: (1.0 - m_params.smoothing) * m_busySeconds + m_params.smoothing * busySeconds;
+		m_numConsumed++;
+	}
+
+	// Called when a frame had to be dropped because consumers were behind
+	void ReportDropped()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_numDropped++;
+	}
+
+	// Frames per second the consumers can take; 0 until measured
+	double GetCapacity() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_busySeconds > 0.0 ? m_params.numConsumers / m_busySeconds : 0.0;
+	}
+
+	// Decides the rate for the next period. elapsedSeconds is the time
+	// since the previous call, nowSeconds any monotonic clock and
+	// queueDepth the frames waiting for the consumers. Returns true if
+	// the rate changed.
+	bool Update(double nowSeconds, double elapsedSeconds, size_t queueDepth)
+	{
+		uint64_t numDropped;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			numDropped = m_numDropped;
+			m_numDropped = 0;
+		}
+
+		const double capacity = GetCapacity();
+		const bool queueGrowing = queueDepth > m_lastQueueDepth + 1;
+		m_lastQueueDepth = queueDepth;
+
+		if (capacity <= 0.0)
+		{
+			return false;
+		}
+
+		const double previous = m_frameRate;
+		const double target = std::min(std::max(capacity * m_params.headroom, m_minFrameRate), m_maxFrameRate);
+
+		if (numDropped > 0 && elapsedSeconds > 0.0)
+		{
+			// Lose at least the dropped share straight away
+			const double droppedRate = numDropped / elapsedSeconds;
+			m_frameRate = std::min(target, m_frameRate - droppedRate);
+			m_raiseSince = -1.0;
+		}
+		else if (queueGrowing || m_frameRate > target * (1.0 + m_params.band))
+		{
+			m_frameRate = std::min(m_frameRate, target);
+			m_raiseSince = -1.0;
+		}
+		else if (target > m_frameRate * (1.0 + m_params.band))
+		{
+			if (m_raiseSince < 0.0)
+			{
+				m_raiseSince = nowSeconds;
+			}
+			else if (nowSeconds - m_raiseSince >= m_params.raiseHoldSeconds)
+			{
+				m_frameRate = std::min(target, m_frameRate * m_params.raiseStep);
+				m_raiseSince = nowSeconds;
+			}
+		}
+		else
+		{
+			m_raiseSince = -1.0;
+		}
+
+		m_frameRate = std::min(std::max(m_frameRate, m_minFrameRate), m_maxFrameRate);
+
+		return m_frameRate != previous;
+	}
+
+private:
+
+	FrameRateGovernorParams m_params;
+	double m_minFrameRate;
+	double m_maxFrameRate;
+	double m_frameRate;
+
+	mutable std::mutex m_mutex;
+	double m_busySeconds;
+	uint64_t m_numConsumed;
+	uint64_t m_numDropped;
+
+	size_t m_lastQueueDepth;
+	double m_raiseSince;
+};
+
+// Applies a FrameRateController to a camera
+class FrameRateGovernor
+{
+public:
+
+	FrameRateGovernor(Spinnaker::CameraPtr pCam, const FrameRateGovernorParams & params = FrameRateGovernorParams())
+		: m_pCam(pCam), m_controller(params), m_enabled(false)
+	{
+	}
+
+	FrameRateController & GetController() { return m_controller; }
+
+	double GetFrameRate() const { return m_controller.GetFrameRate(); }
+
+	// Takes control of the frame rate, starting from the current resulting
+	// rate. Returns -1 if the camera does not allow setting it.
+	int Enable()
+	{
+		using namespace Spinnaker::GenApi;
+
+		try
+		{
+			INodeMap & nodeMap = m_pCam->GetNodeMap();
+
+			if (SetFrameRateEnable(nodeMap, true) != 0)
+			{
+				std::cout << "Unable to enable frame rate control. Aborting..." << std::endl << std::endl;
+				return -1;
+			}
+
+			CFloatPtr ptrFrameRate = nodeMap.GetNode("AcquisitionFrameRate");
+			if (!IsAvailable(ptrFrameRate) || !IsWritable(ptrFrameRate))
+			{
+				std::cout << "Unable to set frame rate (node retrieval). Aborting..." << std::endl << std::endl;
+				return -1;
+			}
+
+			m_controller.SetLimits(std::max(ptrFrameRate->GetMin(), 1.0), ptrFrameRate->GetMax());
+
+			double startRate = ptrFrameRate->GetMax();
+			CFloatPtr ptrResultingFrameRate = nodeMap.GetNode("AcquisitionResultingFrameRate");
+			if (IsAvailable(ptrResultingFrameRate) && IsReadable(ptrResultingFrameRate))
+			{
+				startRate = ptrResultingFrameRate->GetValue();
+			}
+
+			m_controller.SetFrameRate(startRate);
+			ptrFrameRate->SetValue(m_controller.GetFrameRate());
+			m_enabled = true;
+		}
+		catch (Spinnaker::Exception &e)
+		{
+			std::cout << "Error: " << e.what() << std::endl;
+			return -1;
+		}
+
+		return 0;
+	}
+
+	// Runs the controller and writes the rate if it changed. Returns 1 if
+	// it was changed, 0 if not and -1 on error.
+	int Update(double nowSeconds, double elapsedSeconds, size_t queueDepth)
+	{
+		using namespace Spinnaker::GenApi;
+
+		if (!m_enabled || !m_controller.Update(nowSeconds, elapsedSeconds, queueDepth))
+		{
+			return 0;
+		}
+
+		try
+		{
+			CFloatPtr ptrFrameRate = m_pCam->GetNodeMap().GetNode("AcquisitionFrameRate");
+			if (!IsAvailable(ptrFrameRate) || !IsWritable(ptrFrameRate))
+			{
+				return -1;
+			}
+
+			ptrFrameRate->SetValue(m_controller.GetFrameRate());
+		}
+		catch (Spinnaker::Exception &e)
+		{
+			std::cout << "Error: " << e.what() << std::endl;
+			return -1;
+		}
+
+		return 1;
+	}
+
+	// Lets the camera free-run again
+	int Disable()
+	{
+		if (!m_enabled)
+		{
+			return 0;
+		}
+
+		m_enabled = false;
+
+		try
+		{
+			return SetFrameRateEnable(m_pCam->GetNodeMap(), false);
+		}
+		catch (Spinnaker::Exception &e)
+		{
+			std::cout << "Error: " << e.what() << std::endl;
+			return -1;
+		}
+	}
+
+private:
+
+	// Writes whichever of the two enable nodes the camera has
+	static int SetFrameRateEnable(Spinnaker::GenApi::INodeMap & nodeMap, bool enable)
+	{
+		using namespace Spinnaker::GenApi;
+
+		const char* nodeNames[] = { "AcquisitionFrameRateEnable", "AcquisitionFrameRateEnabled" };
+
+		for (unsigned int i = 0; i < 2; i++)
+		{
+			CBooleanPtr ptrEnable = nodeMap.GetNode(nodeNames[i]);
+			if (IsAvailable(ptrEnable) && IsWritable(ptrEnable))
+			{
+				ptrEnable->SetValue(enable);
+				return 0;
+			}
+		}
+
+		return -1;
+	}
+
+	Spinnaker::CameraPtr m_pCam;
+	FrameRateController m_controller;
+	bool m_enabled;
+};
+
+#endif // ABHI_FRAME_RATE_GOVERNOR_H
@@ -0,0 +1,269 @@
+//
+// FrameStacker.h
+//
+// Averages N consecutive frames of a camera for dim scenes, instead of
+// raising Gain and amplifying the noise with the signal. Averaging N frames
+// lowers the noise by sqrt(N).
+//
+// Frames are 8-bit data of a fixed size (Mono8, raw Bayer, BGR8 - every
+// byte is averaged on its own, so raw Bayer frames can be stacked before
+// demosaicing). Sums are kept in 16-bit accumulators for N up to 257 and
+// in 32-bit ones above, and added 16 bytes at a time with SSE2.
+//
+// Two modes:
+// - block: frames 1..N give one output, N+1..2N the next, so the output
+//   rate is the camera rate / N. The first frame of a block is written
+//   into the accumulators instead of added, which saves clearing them.
+// - sliding: every frame gives an output, the average of the last N. The
+//   oldest frame is subtracted as the new one is added; the frames are
+//   kept in a ring, written in the same pass as the add, so there is no
+//   separate copy.
+// The frame passed to Add() is read once and not kept.
+//
+
+#ifndef ABHI_FRAME_STACKER_H
+#define ABHI_FRAME_STACKER_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <emmintrin.h>
+
+class FrameStacker
+{
+public:
+
+	FrameStacker(unsigned int numFrames, bool sliding = false)
+		: m_numFrames(numFrames > 0 ? numFrames : 1), m_sliding(sliding), m_size(0), m_count(0), m_ringPosition(0)
+	{
+		// Rounded reciprocal of N in 24-bit fixed point, for the output
+		m_reciprocal = static_cast<uint32_t>(((1ull << 24) + m_numFrames - 1) / m_numFrames);
+	}
+
+	unsigned int GetNumFrames() const { return m_numFrames; }
+	bool IsSliding() const { return m_sliding; }
+	bool UsesWideAccumulators() const { return m_numFrames > 257; }
+
+	// Forgets all frames added so far
+	void Reset()
+	{
+		m_count = 0;
+		m_ringPosition = 0;
+	}
+
+	// Adds a frame. Returns true when an averaged frame is ready in
+	// GetOutput(). A frame of another size starts over.
+	bool Add(const uint8_t* frame, size_t size)
+	{
+		if (size != m_size)
+		{
+			Allocate(size);
+		}
+
+		if (m_sliding)
+		{
+			AddSliding(frame);
+		}
+		else if (m_count % m_numFrames == 0)
+		{
+			Assign(frame);
+		}
+		else
+		{
+			Accumulate(frame);
+		}
+
+		m_count++;
+
+		if (m_sliding ? m_count >= m_numFrames : m_count % m_numFrames == 0)
+		{
+			WriteOutput();
+			return true;
+		}
+
+		return false;
+	}
+
+	// The last averaged frame, same layout as the input
+	const uint8_t* GetOutput() const { return m_output.empty() ? NULL : &m_output[0]; }
+	size_t GetSize() const { return m_size; }
+
+private:
+
+	void Allocate(size_t size)
+	{
+		m_size = size;
+		m_count = 0;
+		m_ringPosition = 0;
+
+		if (UsesWideAccumulators())
+		{
+			m_sums32.assign(size, 0);
+			m_sums16.clear();
+		}
+		else
+		{
+			m_sums16.assign(size, 0);
+			m_sums32.clear();
+		}
+
+		m_output.assign(size, 0);
+		m_ring.assign(m_sliding ? size * m_numFrames : 0, 0);
+	}
+
+	// First frame of a block: widen into the accumulators
+	void Assign(const uint8_t* frame)
+	{
+		if (UsesWideAccumulators())
+		{
+			for (size_t i = 0; i < m_size; i++)
+			{
+				m_sums32[i] = frame[i];
+			}
+			return;
+		}
+
+		const __m128i zero = _mm_setzero_si128();
+		uint16_t* sums = &m_sums16[0];
+		size_t i = 0;
+
+		for (; i + 16 <= m_size; i += 16)
+		{
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i), _mm_unpacklo_epi8(pixels, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(sums + i + 8), _mm_unpackhi_epi8(pixels, zero));
+		}
+
+		for (; i < m_size; i++)
+		{
+			sums[i] = frame[i];
+		}
+	}
+
+	void Accumulate(const uint8_t* frame)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		size_t i = 0;
+
+		if (UsesWideAccumulators())
+		{
+			uint32_t* sums = &m_sums32[0];
+
+			for (; i + 16 <= m_size; i += 16)
+			{
+				const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame + i));
+				const __m128i low = _mm_unpacklo_epi8(pixels, zero);
+				const __m128i high = _mm_unpackhi_epi8(pixels, zero);
+
+				__m128i* target = reinterpret_cast<__m128i*>(sums + i);
+				_mm_storeu_si128(target, _mm_add_epi32(_mm_loadu_si128(target), _mm_unpacklo_epi16(low, zero)));
+				_mm_storeu_si128(target + 1, _mm_add_epi32(_mm_loadu_si128(target + 1), _mm_unpackhi_epi16(low, zero)));
+				_mm_storeu_si128(target + 2, _mm_add_epi32(_mm_loadu_si128(target + 2), _mm_unpacklo_epi16(high, zero)));
+				_mm_storeu_si128(target + 3, _mm_add_epi32(_mm_loadu_si128(target + 3), _mm_unpackhi_epi16(high, zero)));
+			}
+
+			for (; i < m_size; i++)
+			{
+				sums[i] += frame[i];
+			}
+			return;
+		}
+
+		uint16_t* sums = &m_sums16[0];
+
+		for (; i + 16 <= m_size; i += 16)
+		{
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame + i));
+
+			__m128i* target = reinterpret_cast<__m128i*>(sums + i);
+			_mm_storeu_si128(target, _mm_add_epi16(_mm_loadu_si128(target), _mm_unpacklo_epi8(pixels, zero)));
+			_mm_storeu_si128(target + 1, _mm_add_epi16(_mm_loadu_si128(target + 1), _mm_unpackhi_epi8(pixels, zero)));
+		}
+
+		for (; i < m_size; i++)
+		{
+			sums[i] += frame[i];
+		}
+	}
+
+	// Adds the new frame, subtracts the one it replaces in the ring and
+	// stores the new one there, in one pass. Until the ring is full the
+	// slot holds zeros.
+	void AddSliding(const uint8_t* frame)
+	{
+		uint8_t* slot = &m_ring[m_ringPosition * m_size];
+		m_ringPosition = (m_ringPosition + 1) % m_numFrames;
+
+		size_t i = 0;
+
+		if (UsesWideAccumulators())
+		{
+			uint32_t* sums = &m_sums32[0];
+
+			for (; i < m_size; i++)
+			{
+				sums[i] += static_cast<uint32_t>(frame[i]) - slot[i];
+				slot[i] = frame[i];
+			}
+			return;
+		}
+
+		const __m128i zero = _mm_setzero_si128();
+		uint16_t* sums = &m_sums16[0];
+
+		for (; i + 16 <= m_size; i += 16)
+		{
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(frame + i));
+			const __m128i oldest = _mm_loadu_si128(reinterpret_cast<const __m128i*>(slot + i));
+
+			__m128i* target = reinterpret_cast<__m128i*>(sums + i);
+			__m128i low = _mm_add_epi16(_mm_loadu_si128(target), _mm_unpacklo_epi8(pixels, zero));
+			__m128i high = _mm_add_epi16(_mm_loadu_si128(target + 1), _mm_unpackhi_epi8(pixels, zero));
+			_mm_storeu_si128(target, _mm_sub_epi16(low, _mm_unpacklo_epi8(oldest, zero)));
+			_mm_storeu_si128(target + 1, _mm_sub_epi16(high, _mm_unpackhi_epi8(oldest, zero)));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(slot + i), pixels);
+		}
+
+		for (; i < m_size; i++)
+		{
+			sums[i] = static_cast<uint16_t>(sums[i] + frame[i] - slot[i]);
+			slot[i] = frame[i];
+		}
+	}
+
+	// Divides the sums by N with rounding
+	void WriteOutput()
+	{
+		const uint64_t half = m_numFrames / 2;
+
+		if (UsesWideAccumulators())
+		{
+			for (size_t i = 0; i < m_size; i++)
+			{
+				m_output[i] = static_cast<uint8_t>(((m_sums32[i] + half) * m_reciprocal) >> 24);
+			}
+			return;
+		}
+
+		for (size_t i = 0; i < m_size; i++)
+		{
+			m_output[i] = static_cast<uint8_t>(((m_sums16[i] + half) * m_reciprocal) >> 24);
+		}
+	}
+
+	unsigned int m_numFrames;
+	bool m_sliding;
+	uint32_t m_reciprocal;
+
+	size_t m_size;
+	uint64_t m_count;
+	unsigned int m_ringPosition;
+
+	std::vector<uint16_t> m_sums16;
+	std::vector<uint32_t> m_sums32;
+	std::vector<uint8_t> m_ring;
+	std::vector<uint8_t> m_output;
+};
+
+#endif // ABHI_FRAME_STACKER_H
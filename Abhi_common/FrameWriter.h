@@ -0,0 +1,68 @@
+//
+// FrameWriter.h
+//
+// The interface the save paths write frames through, in place of calling
+// cv::imwrite() or Image::Save() directly, so the encoder behind it can be
+// swapped (OpenCV, striped parallel JPEG, ...) without touching the
+// acquisition loops.
+//
+
+#ifndef ABHI_FRAME_WRITER_H
+#define ABHI_FRAME_WRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// An 8-bit frame in memory: Mono8 (1 channel) or BGR8 (3 channels)
+struct FrameView
+{
+	FrameView() : data(NULL), width(0), height(0), channels(1), stride(0) {}
+
+	FrameView(const uint8_t* frameData, unsigned int frameWidth, unsigned int frameHeight, unsigned int frameChannels, size_t frameStride)
+		: data(frameData), width(frameWidth), height(frameHeight), channels(frameChannels), stride(frameStride)
+	{
+	}
+
+	const uint8_t* data;
+	unsigned int width;
+	unsigned int height;
+	unsigned int channels;
+	size_t stride;
+};
+
+class FrameWriter
+{
+public:
+
+	virtual ~FrameWriter() {}
+
+	// Encodes the frame and writes it to path. Returns -1 on error.
+	virtual int Write(const std::string & path, const FrameView & frame) = 0;
+};
+
+// This helper writes a buffer to a file. Returns -1 on error.
+inline int WriteFileBytes(const std::string & path, const std::vector<uint8_t> & bytes)
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == NULL)
+	{
+		return -1;
+	}
+
+	int result = 0;
+	if (!bytes.empty() && fwrite(&bytes[0], 1, bytes.size(), file) != bytes.size())
+	{
+		result = -1;
+	}
+
+	if (fclose(file) != 0)
+	{
+		result = -1;
+	}
+
+	return result;
+}
+
+#endif // ABHI_FRAME_WRITER_H
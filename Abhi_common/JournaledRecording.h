@@ -0,0 +1,810 @@
+//
+// JournaledRecording.h
+//
+// A raw recording format that stays usable when the recording process dies.
+// AVI files (SaveToAvi, AVIRecorder) only get their index at AVIClose(), so
+// a crash loses the whole file; here the index is journaled as the
+// recording goes on.
+//
+// Layout, all append-only:
+//
+//	file header
+//	frame block		block header + JournalFrameInfo + image bytes
+//	frame block
+//	...
+//	index block		block header + JournalIndexInfo + JournalFrameEntry[]
+//	frame block		(frames since the previous index block)
+//	...
+//	footer block		only after a clean close
+//
+// Every block header carries its own CRC and the CRC-32C of its payload. An
+// index block lists the frames written since the previous index block and
+// points back to it, so a cleanly closed file is opened from the footer
+// without reading the frames.
+//
+// Durability is batched: a background thread calls fdatasync() every
+// syncIntervalMs, so the writer never waits for the disk. After a crash,
+// RecoverJournal() walks the block headers, checks the frames at the end
+// that may not have reached the disk, cuts the file after the last
+// consistent frame and writes the missing index block and footer.
+//
+
+#ifndef ABHI_JOURNALED_RECORDING_H
+#define ABHI_JOURNALED_RECORDING_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "Crc32c.h"
+
+const char k_journalMagic[8] = { 'A', 'B', 'H', 'I', 'J', 'R', 'N', '1' };
+const uint32_t k_journalVersion = 1;
+
+enum journalBlockType
+{
+	JOURNAL_FRAME_BLOCK = 0x4D415246,	// "FRAM"
+	JOURNAL_INDEX_BLOCK = 0x58444E49,	// "INDX"
+	JOURNAL_FOOTER_BLOCK = 0x4C494154	// "TAIL"
+};
+
+struct JournalFileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t width;
+	uint32_t height;
+	uint32_t pixelFormat;		// Spinnaker PixelFormatEnums value
+	uint32_t reserved;
+	char serial[32];
+	uint32_t reserved2;
+	uint32_t headerCrc;			// over all fields above
+};
+
+struct JournalBlockHeader
+{
+	uint32_t type;				// journalBlockType
+	uint32_t reserved;
+	uint64_t payloadSize;
+	uint64_t sequence;			// block number, from 0
+	uint32_t payloadCrc;
+	uint32_t headerCrc;			// over all fields above
+};
+
+// Start of every frame block payload; the image follows
+struct JournalFrameInfo
+{
+	uint64_t frameId;
+	uint64_t hostTimestampNs;
+	uint64_t cameraTimestampNs;
+	uint64_t imageSize;
+};
+
+// One frame in an index block, and in the reader's index
+struct JournalFrameEntry
+{
+	uint64_t offset;			// of the frame's block header
+	uint64_t frameId;
+	uint64_t hostTimestampNs;
+	uint64_t cameraTimestampNs;
+	uint32_t imageSize;
+	uint32_t imageCrc;			// CRC-32C of the image bytes
+};
+
+// Start of every index block payload; the entries follow
+struct JournalIndexInfo
+{
+	uint64_t previousIndexOffset;	// 0 for the first index block
+	uint64_t firstFrameNumber;
+};
+
+// Footer block payload
+struct JournalFooterInfo
+{
+	uint64_t lastIndexOffset;
+	uint64_t numFrames;
+};
+
+// This helper fills in the CRC of a block header.
+inline void SealBlockHeader(JournalBlockHeader & header)
+{
+	header.headerCrc = Crc32c(&header, offsetof(JournalBlockHeader, headerCrc));
+}
+
+// This helper checks the CRC and type of a block header.
+inline bool IsValidBlockHeader(const JournalBlockHeader & header)
+{
+	return (header.type == JOURNAL_FRAME_BLOCK || header.type == JOURNAL_INDEX_BLOCK || header.type == JOURNAL_FOOTER_BLOCK) &&
+		header.headerCrc == Crc32c(&header, offsetof(JournalBlockHeader, headerCrc));
+}
+
+// This helper writes a block (header and up to two payload parts) at an
+// offset. Returns the bytes written, or -1.
+inline ssize_t WriteJournalBlock(int fd, uint64_t offset, journalBlockType type, uint64_t sequence,
+	const void* first, size_t firstSize, const void* second, size_t secondSize, uint32_t secondCrc)
+{
+	JournalBlockHeader header;
+	memset(&header, 0, sizeof(header));
+	header.type = type;
+	header.payloadSize = firstSize + secondSize;
+	header.sequence = sequence;
+
+	// The payload CRC covers the first part followed by the CRC of the
+	// second part, so an image CRC computed on arrival is not redone here
+	header.payloadCrc = Crc32c(&secondCrc, sizeof(secondCrc), Crc32c(first, firstSize));
+	SealBlockHeader(header);
+
+	struct iovec parts[3];
+	parts[0].iov_base = &header;
+	parts[0].iov_len = sizeof(header);
+	parts[1].iov_base = const_cast<void*>(first);
+	parts[1].iov_len = firstSize;
+	parts[2].iov_base = const_cast<void*>(second);
+	parts[2].iov_len = secondSize;
+
+	const ssize_t size = static_cast<ssize_t>(sizeof(header) + firstSize + secondSize);
+	if (pwritev(fd, parts, secondSize > 0 ? 3 : 2, static_cast<off_t>(offset)) != size)
+	{
+		return -1;
+	}
+
+	return size;
+}
+
+// This helper reads a whole block payload and checks it against the header.
+inline bool ReadJournalPayload(int fd, uint64_t offset, const JournalBlockHeader & header,
+	std::vector<uint8_t> & payload, size_t firstSize)
+{
+	payload.resize(static_cast<size_t>(header.payloadSize));
+
+	if (!payload.empty() &&
+		pread(fd, &payload[0], payload.size(), static_cast<off_t>(offset + sizeof(header))) != static_cast<ssize_t>(payload.size()))
+	{
+		return false;
+	}
+
+	if (firstSize > payload.size())
+	{
+		return false;
+	}
+
+	const uint8_t* data = payload.empty() ? NULL : &payload[0];
+	uint32_t secondCrc = Crc32c(data + firstSize, payload.size() - firstSize);
+
+	return header.payloadCrc == Crc32c(&secondCrc, sizeof(secondCrc), Crc32c(data, firstSize));
+}
+
+// Writes a journaled recording. Append() must be called from one thread.
+class JournaledRecorder
+{
+public:
+
+	JournaledRecorder(unsigned int indexInterval = 32, unsigned int syncIntervalMs = 500)
+		: m_fd(-1), m_indexInterval(indexInterval), m_syncIntervalMs(syncIntervalMs),
+		m_offset(0), m_sequence(0), m_numFrames(0), m_lastIndexOffset(0),
+		m_writtenOffset(0), m_durableOffset(0), m_stopSync(false)
+	{
+	}
+
+	~JournaledRecorder()
+	{
+		Close();
+	}
+
+	// Creates the file; an existing file is replaced. Returns -1 on error.
+	int Open(const std::string & path, uint32_t width, uint32_t height, uint32_t pixelFormat, const std::string & serial)
+	{
+		Close();
+
+		m_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (m_fd < 0)
+		{
+			return -1;
+		}
+
+		JournalFileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, k_journalMagic, sizeof(header.magic));
+		header.version = k_journalVersion;
+		header.headerSize = sizeof(header);
+		header.width = width;
+		header.height = height;
+		header.pixelFormat = pixelFormat;
+		strncpy(header.serial, serial.c_str(), sizeof(header.serial) - 1);
+		header.headerCrc = Crc32c(&header, offsetof(JournalFileHeader, headerCrc));
+
+		if (pwrite(m_fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+		{
+			close(m_fd);
+			m_fd = -1;
+			return -1;
+		}
+
+		m_offset = sizeof(header);
+		m_sequence = 0;
+		m_numFrames = 0;
+		m_lastIndexOffset = 0;
+		m_pendingEntries.clear();
+		m_writtenOffset = m_offset;
+		m_durableOffset = 0;
+		m_stopSync = false;
+
+		m_syncThread = std::thread(&JournaledRecorder::SyncLoop, this);
+
+		return 0;
+	}
+
+	bool IsOpen() const
+	{
+		return m_fd >= 0;
+	}
+
+	// Appends a frame. imageCrc is the CRC-32C of the image if the caller
+	// already has it; pass 0 with haveCrc false to have it computed here.
+	int Append(const void* image, size_t imageSize, uint64_t frameId, uint64_t hostTimestampNs,
+		uint64_t cameraTimestampNs, uint32_t imageCrc = 0, bool haveCrc = false)
+	{
+		if (m_fd < 0)
+		{
+			return -1;
+		}
+
+		if (!haveCrc)
+		{
+			imageCrc = Crc32c(image, imageSize);
+		}
+
+		JournalFrameInfo info;
+		info.frameId = frameId;
+		info.hostTimestampNs = hostTimestampNs;
+		info.cameraTimestampNs = cameraTimestampNs;
+		info.imageSize = imageSize;
+
+		ssize_t written = WriteJournalBlock(m_fd, m_offset, JOURNAL_FRAME_BLOCK, m_sequence, &info, sizeof(info), image, imageSize, imageCrc);
+		if (written < 0)
+		{
+			return -1;
+		}
+
+		JournalFrameEntry entry;
+		entry.offset = m_offset;
+		entry.frameId = frameId;
+		entry.hostTimestampNs = hostTimestampNs;
+		entry.cameraTimestampNs = cameraTimestampNs;
+		entry.imageSize = static_cast<uint32_t>(imageSize);
+		entry.imageCrc = imageCrc;
+
+		m_pendingEntries.push_back(entry);
+		m_offset += written;
+		m_sequence++;
+		m_numFrames++;
+		m_writtenOffset = m_offset;
+
+		if (m_pendingEntries.size() >= m_indexInterval)
+		{
+			return WriteIndexBlock();
+		}
+
+		return 0;
+	}
+
+	// Writes the last index block and the footer, syncs and closes.
+	int Close()
+	{
+		if (m_fd < 0)
+		{
+			return 0;
+		}
+
+		int result = WriteIndexBlock();
+
+		JournalFooterInfo footer;
+		footer.lastIndexOffset = m_lastIndexOffset;
+		footer.numFrames = m_numFrames;
+
+		if (WriteJournalBlock(m_fd, m_offset, JOURNAL_FOOTER_BLOCK, m_sequence, &footer, sizeof(footer), NULL, 0, 0) < 0)
+		{
+			result = -1;
+		}
+
+		StopSyncThread();
+
+		if (fdatasync(m_fd) != 0)
+		{
+			result = -1;
+		}
+
+		close(m_fd);
+		m_fd = -1;
+
+		return result;
+	}
+
+	uint64_t GetNumFrames() const { return m_numFrames; }
+
+	// Bytes known to be on disk; everything before survives a power loss
+	uint64_t GetDurableOffset() const { return m_durableOffset; }
+
+private:
+
+	int WriteIndexBlock()
+	{
+		if (m_pendingEntries.empty())
+		{
+			return 0;
+		}
+
+		JournalIndexInfo info;
+		info.previousIndexOffset = m_lastIndexOffset;
+		info.firstFrameNumber = m_numFrames - m_pendingEntries.size();
+
+		const size_t entriesSize = m_pendingEntries.size() * sizeof(JournalFrameEntry);
+
+		ssize_t written = WriteJournalBlock(m_fd, m_offset, JOURNAL_INDEX_BLOCK, m_sequence, &info, sizeof(info),
+			&m_pendingEntries[0], entriesSize, Crc32c(&m_pendingEntries[0], entriesSize));
+		if (written < 0)
+		{
+			return -1;
+		}
+
+		m_lastIndexOffset = m_offset;
+		m_offset += written;
+		m_sequence++;
+		m_writtenOffset = m_offset;
+		m_pendingEntries.clear();
+
+		return 0;
+	}
+
+	void SyncLoop()
+	{
+		std::unique_lock<std::mutex> lock(m_syncMutex);
+
+		while (!m_stopSync)
+		{
+			m_syncWake.wait_for(lock, std::chrono::milliseconds(m_syncIntervalMs));
+			if (m_stopSync)
+			{
+				break;
+			}
+
+			uint64_t written = m_writtenOffset;
+			if (written == m_durableOffset)
+			{
+				continue;
+			}
+
+			lock.unlock();
+			bool synced = fdatasync(m_fd) == 0;
+			lock.lock();
+
+			if (synced)
+			{
+				m_durableOffset = written;
+			}
+		}
+	}
+
+	void StopSyncThread()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_syncMutex);
+			m_stopSync = true;
+		}
+		m_syncWake.notify_all();
+
+		if (m_syncThread.joinable())
+		{
+			m_syncThread.join();
+		}
+	}
+
+	int m_fd;
+	unsigned int m_indexInterval;
+	unsigned int m_syncIntervalMs;
+
+	uint64_t m_offset;
+	uint64_t m_sequence;
+	uint64_t m_numFrames;
+	uint64_t m_lastIndexOffset;
+	std::vector<JournalFrameEntry> m_pendingEntries;
+
+	std::atomic<uint64_t> m_writtenOffset;
+	std::atomic<uint64_t> m_durableOffset;
+	std::thread m_syncThread;
+	std::mutex m_syncMutex;
+	std::condition_variable m_syncWake;
+	bool m_stopSync;
+};
+
+// Reads a cleanly closed (or recovered) journaled recording
+class JournaledReader
+{
+public:
+
+	JournaledReader() : m_fd(-1)
+	{
+		memset(&m_header, 0, sizeof(m_header));
+	}
+
+	~JournaledReader()
+	{
+		Close();
+	}
+
+	// Opens the file and loads its index from the footer. Returns -1 if the
+	// file is not a journaled recording and -2 if it needs recovery.
+	int Open(const std::string & path)
+	{
+		Close();
+
+		m_fd = open(path.c_str(), O_RDONLY);
+		if (m_fd < 0)
+		{
+			return -1;
+		}
+
+		if (pread(m_fd, &m_header, sizeof(m_header), 0) != static_cast<ssize_t>(sizeof(m_header)) ||
+			memcmp(m_header.magic, k_journalMagic, sizeof(m_header.magic)) != 0 ||
+			m_header.headerCrc != Crc32c(&m_header, offsetof(JournalFileHeader, headerCrc)))
+		{
+			Close();
+			return -1;
+		}
+
+		// The footer is the last block
+		struct stat fileStat;
+		const off_t footerSize = sizeof(JournalBlockHeader) + sizeof(JournalFooterInfo);
+
+		JournalBlockHeader blockHeader;
+		JournalFooterInfo footer;
+		std::vector<uint8_t> payload;
+
+		if (fstat(m_fd, &fileStat) != 0 || fileStat.st_size < static_cast<off_t>(m_header.headerSize) + footerSize ||
+			pread(m_fd, &blockHeader, sizeof(blockHeader), fileStat.st_size - footerSize) != static_cast<ssize_t>(sizeof(blockHeader)) ||
+			!IsValidBlockHeader(blockHeader) || blockHeader.type != JOURNAL_FOOTER_BLOCK ||
+			!ReadJournalPayload(m_fd, fileStat.st_size - footerSize, blockHeader, payload, sizeof(footer)))
+		{
+			return -2;
+		}
+
+		memcpy(&footer, &payload[0], sizeof(footer));
+
+		// Walk the index blocks back to front
+		std::vector<std::vector<JournalFrameEntry> > blocks;
+		uint64_t indexOffset = footer.lastIndexOffset;
+
+		while (indexOffset != 0)
+		{
+			if (pread(m_fd, &blockHeader, sizeof(blockHeader), indexOffset) != static_cast<ssize_t>(sizeof(blockHeader)) ||
+				!IsValidBlockHeader(blockHeader) || blockHeader.type != JOURNAL_INDEX_BLOCK ||
+				!ReadJournalPayload(m_fd, indexOffset, blockHeader, payload, sizeof(JournalIndexInfo)))
+			{
+				m_entries.clear();
+				return -2;
+			}
+
+			JournalIndexInfo info;
+			memcpy(&info, &payload[0], sizeof(info));
+
+			const size_t numEntries = (payload.size() - sizeof(info)) / sizeof(JournalFrameEntry);
+			blocks.push_back(std::vector<JournalFrameEntry>(numEntries));
+			if (numEntries > 0)
+			{
+				memcpy(&blocks.back()[0], &payload[sizeof(info)], numEntries * sizeof(JournalFrameEntry));
+			}
+
+			if (info.previousIndexOffset >= indexOffset)
+			{
+				m_entries.clear();
+				return -2;
+			}
+			indexOffset = info.previousIndexOffset;
+		}
+
+		for (size_t i = blocks.size(); i > 0; i--)
+		{
+			m_entries.insert(m_entries.end(), blocks[i - 1].begin(), blocks[i - 1].end());
+		}
+
+		if (m_entries.size() != footer.numFrames)
+		{
+			m_entries.clear();
+			return -2;
+		}
+
+		return 0;
+	}
+
+	void Close()
+	{
+		if (m_fd >= 0)
+		{
+			close(m_fd);
+			m_fd = -1;
+		}
+		m_entries.clear();
+	}
+
+	const JournalFileHeader & GetHeader() const { return m_header; }
+	size_t GetNumFrames() const { return m_entries.size(); }
+	const JournalFrameEntry & GetEntry(size_t index) const { return m_entries[index]; }
+
+	// Reads the image of a frame. With verify set, the image CRC from the
+	// index is checked; returns -1 on a read error, -2 on a CRC mismatch.
+	int ReadFrame(size_t index, std::vector<uint8_t> & image, bool verify = true) const
+	{
+		const JournalFrameEntry & entry = m_entries[index];
+
+		image.resize(entry.imageSize);
+
+		const off_t imageOffset = static_cast<off_t>(entry.offset + sizeof(JournalBlockHeader) + sizeof(JournalFrameInfo));
+		if (entry.imageSize > 0 && pread(m_fd, &image[0], entry.imageSize, imageOffset) != static_cast<ssize_t>(entry.imageSize))
+		{
+			return -1;
+		}
+
+		if (verify && Crc32c(image.empty() ? NULL : &image[0], image.size()) != entry.imageCrc)
+		{
+			return -2;
+		}
+
+		return 0;
+	}
+
+private:
+
+	int m_fd;
+	JournalFileHeader m_header;
+	std::vector<JournalFrameEntry> m_entries;
+};
+
+// Outcome of a recovery
+struct JournalRecoveryReport
+{
+	JournalRecoveryReport() : wasClean(false), numFrames(0), numIndexedFrames(0), numFramesReindexed(0), bytesCut(0) {}
+
+	bool wasClean;				// footer was valid, nothing to do
+	uint64_t numFrames;			// frames in the recovered file
+	uint64_t numIndexedFrames;	// of those, covered by an index block already
+	uint64_t numFramesReindexed;
+	uint64_t bytesCut;
+};
+
+// Frames in the last this many bytes of a file get their images checked
+// during recovery. Only data written since the last fdatasync() can be
+// lost, so this needs to be well above what is written in one sync interval.
+const uint64_t k_journalVerifyTailBytes = 1ull << 30;
+
+// This function makes a journaled recording readable again after a crash.
+// Block headers are walked from the start, and the images of the frames in
+// the last verifyTailBytes of the file are checked (all of them if
+// verifyTailBytes is 0). The file is cut after the last consistent frame,
+// and an index block for the frames not yet indexed plus a footer are
+// written. Returns -1 on error.
+inline int RecoverJournal(const std::string & path, JournalRecoveryReport & report, uint64_t verifyTailBytes = k_journalVerifyTailBytes)
+{
+	report = JournalRecoveryReport();
+
+	{
+		JournaledReader reader;
+		int openResult = reader.Open(path);
+		if (openResult == 0)
+		{
+			report.wasClean = true;
+			report.numFrames = reader.GetNumFrames();
+			report.numIndexedFrames = report.numFrames;
+			return 0;
+		}
+		if (openResult == -1)
+		{
+			return -1;
+		}
+	}
+
+	int fd = open(path.c_str(), O_RDWR);
+	if (fd < 0)
+	{
+		return -1;
+	}
+
+	struct stat fileStat;
+	JournalFileHeader fileHeader;
+
+	if (fstat(fd, &fileStat) != 0 || pread(fd, &fileHeader, sizeof(fileHeader), 0) != static_cast<ssize_t>(sizeof(fileHeader)))
+	{
+		close(fd);
+		return -1;
+	}
+
+	const uint64_t fileSize = static_cast<uint64_t>(fileStat.st_size);
+
+	// Walk the blocks while they are consistent
+	struct IndexBlockPosition
+	{
+		uint64_t offset;
+		uint64_t numFramesBefore;
+		uint64_t end;
+	};
+
+	std::vector<JournalFrameEntry> entries;
+	std::vector<IndexBlockPosition> indexBlocks;
+	std::vector<uint8_t> payload;
+
+	uint64_t offset = fileHeader.headerSize;
+	uint64_t sequence = 0;
+
+	while (offset + sizeof(JournalBlockHeader) <= fileSize)
+	{
+		JournalBlockHeader header;
+		if (pread(fd, &header, sizeof(header), offset) != static_cast<ssize_t>(sizeof(header)) ||
+			!IsValidBlockHeader(header) || header.sequence != sequence ||
+			header.payloadSize > fileSize - offset - sizeof(header) || header.type == JOURNAL_FOOTER_BLOCK)
+		{
+			break;
+		}
+
+		if (header.type == JOURNAL_FRAME_BLOCK)
+		{
+			JournalFrameInfo info;
+			if (header.payloadSize < sizeof(info) ||
+				pread(fd, &info, sizeof(info), offset + sizeof(header)) != static_cast<ssize_t>(sizeof(info)) ||
+				info.imageSize != header.payloadSize - sizeof(info))
+			{
+				break;
+			}
+
+			JournalFrameEntry entry;
+			entry.offset = offset;
+			entry.frameId = info.frameId;
+			entry.hostTimestampNs = info.hostTimestampNs;
+			entry.cameraTimestampNs = info.cameraTimestampNs;
+			entry.imageSize = static_cast<uint32_t>(info.imageSize);
+			entry.imageCrc = 0;		// filled in below or from the index
+			entries.push_back(entry);
+		}
+		else
+		{
+			if (!ReadJournalPayload(fd, offset, header, payload, sizeof(JournalIndexInfo)))
+			{
+				break;
+			}
+
+			// Take the image CRCs from the index
+			const size_t numEntries = (payload.size() - sizeof(JournalIndexInfo)) / sizeof(JournalFrameEntry);
+			const JournalFrameEntry* indexed = reinterpret_cast<const JournalFrameEntry*>(&payload[sizeof(JournalIndexInfo)]);
+
+			if (numEntries > entries.size())
+			{
+				break;
+			}
+
+			for (size_t i = 0; i < numEntries; i++)
+			{
+				entries[entries.size() - numEntries + i].imageCrc = indexed[i].imageCrc;
+			}
+
+			IndexBlockPosition position;
+			position.offset = offset;
+			position.numFramesBefore = entries.size();
+			position.end = offset + sizeof(header) + header.payloadSize;
+			indexBlocks.push_back(position);
+		}
+
+		offset += sizeof(header) + header.payloadSize;
+		sequence++;
+	}
+
+	// Check the images of the frames that may not have reached the disk
+	uint64_t verifyFrom = 0;
+	while (verifyTailBytes > 0 && verifyFrom < entries.size() && entries[verifyFrom].offset + verifyTailBytes < fileSize)
+	{
+		verifyFrom++;
+	}
+
+	const uint64_t firstUnindexed = indexBlocks.empty() ? 0 : indexBlocks.back().numFramesBefore;
+
+	for (uint64_t i = verifyFrom; i < entries.size(); i++)
+	{
+		JournalBlockHeader header;
+		if (pread(fd, &header, sizeof(header), entries[i].offset) != static_cast<ssize_t>(sizeof(header)) ||
+			!ReadJournalPayload(fd, entries[i].offset, header, payload, sizeof(JournalFrameInfo)))
+		{
+			entries.resize(i);
+			break;
+		}
+
+		const uint32_t imageCrc = Crc32c(&payload[sizeof(JournalFrameInfo)], payload.size() - sizeof(JournalFrameInfo));
+		if (i < firstUnindexed && imageCrc != entries[i].imageCrc)
+		{
+			entries.resize(i);
+			break;
+		}
+		entries[i].imageCrc = imageCrc;
+	}
+
+	// Keep the index blocks that only cover kept frames
+	while (!indexBlocks.empty() && indexBlocks.back().numFramesBefore > entries.size())
+	{
+		indexBlocks.pop_back();
+	}
+
+	uint64_t cut = fileHeader.headerSize;
+	if (!entries.empty())
+	{
+		cut = entries.back().offset + sizeof(JournalBlockHeader) + sizeof(JournalFrameInfo) + entries.back().imageSize;
+	}
+	if (!indexBlocks.empty() && indexBlocks.back().end > cut)
+	{
+		cut = indexBlocks.back().end;
+	}
+
+	// Frames are numbered by block sequence; count the blocks kept
+	uint64_t nextSequence = entries.size() + indexBlocks.size();
+
+	int result = 0;
+
+	if (ftruncate(fd, static_cast<off_t>(cut)) != 0)
+	{
+		result = -1;
+	}
+
+	report.bytesCut = fileSize - cut;
+	report.numFrames = entries.size();
+	report.numIndexedFrames = indexBlocks.empty() ? 0 : indexBlocks.back().numFramesBefore;
+	report.numFramesReindexed = report.numFrames - report.numIndexedFrames;
+
+	uint64_t lastIndexOffset = indexBlocks.empty() ? 0 : indexBlocks.back().offset;
+	offset = cut;
+
+	if (result == 0 && report.numFramesReindexed > 0)
+	{
+		JournalIndexInfo info;
+		info.previousIndexOffset = lastIndexOffset;
+		info.firstFrameNumber = report.numIndexedFrames;
+
+		const JournalFrameEntry* pending = &entries[static_cast<size_t>(report.numIndexedFrames)];
+		const size_t entriesSize = static_cast<size_t>(report.numFramesReindexed) * sizeof(JournalFrameEntry);
+
+		ssize_t written = WriteJournalBlock(fd, offset, JOURNAL_INDEX_BLOCK, nextSequence++, &info, sizeof(info),
+			pending, entriesSize, Crc32c(pending, entriesSize));
+		if (written < 0)
+		{
+			result = -1;
+		}
+		else
+		{
+			lastIndexOffset = offset;
+			offset += written;
+		}
+	}
+
+	if (result == 0)
+	{
+		JournalFooterInfo footer;
+		footer.lastIndexOffset = lastIndexOffset;
+		footer.numFrames = entries.size();
+
+		if (WriteJournalBlock(fd, offset, JOURNAL_FOOTER_BLOCK, nextSequence, &footer, sizeof(footer), NULL, 0, 0) < 0 ||
+			fdatasync(fd) != 0)
+		{
+			result = -1;
+		}
+	}
+
+	close(fd);
+
+	return result;
+}
+
+#endif // ABHI_JOURNALED_RECORDING_H
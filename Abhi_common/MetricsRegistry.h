@@ -0,0 +1,87 @@
+//
+// MetricsRegistry.h
+//
+// A small thread-safe store of named values shared by the acquisition,
+// processing and monitoring threads. Gauges hold the most recent value of
+// something (temperature, queue depth); counters accumulate (frames grabbed,
+// frames dropped). Readers take a snapshot instead of holding the lock.
+//
+// Names are dotted paths, usually "<camera label>.<metric>", e.g.
+// "cam0.DeviceTemperature".
+//
+
+#ifndef ABHI_METRICS_REGISTRY_H
+#define ABHI_METRICS_REGISTRY_H
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+
+class MetricsRegistry
+{
+public:
+
+	MetricsRegistry() {}
+	~MetricsRegistry() {}
+
+	// Replaces the value of a gauge
+	void SetGauge(const std::string & name, double value)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_values[name] = value;
+	}
+
+	// Adds to a counter, creating it at zero if needed
+	void AddCounter(const std::string & name, double delta = 1.0)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_values[name] += delta;
+	}
+
+	// Returns false if nothing has been published under that name yet
+	bool Get(const std::string & name, double & value) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		std::map<std::string, double>::const_iterator it = m_values.find(name);
+		if (it == m_values.end())
+		{
+			return false;
+		}
+
+		value = it->second;
+		return true;
+	}
+
+	std::map<std::string, double> Snapshot() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_values;
+	}
+
+	// Prints all values whose name starts with the given prefix
+	void Print(std::ostream & out = std::cout, const std::string & prefix = "") const
+	{
+		std::map<std::string, double> values = Snapshot();
+
+		std::map<std::string, double>::const_iterator it;
+		for (it = values.begin(); it != values.end(); ++it)
+		{
+			if (it->first.compare(0, prefix.size(), prefix) != 0)
+			{
+				continue;
+			}
+
+			out << "\t" << std::left << std::setw(40) << it->first << std::right << it->second << std::endl;
+		}
+	}
+
+private:
+
+	std::map<std::string, double> m_values;
+	mutable std::mutex m_mutex;
+};
+
+#endif // ABHI_METRICS_REGISTRY_H
@@ -0,0 +1,263 @@
+//
+// MjpegAviWriter.h
+//
+// Writes Motion-JPEG AVI files from frames that are already JPEG encoded,
+// so encoding can happen anywhere (in parallel, ahead of time) and the file
+// is only assembled here. The files play like the MJPG files AVIRecorder
+// writes. Plain AVI 1.0 (RIFF with an idx1 index) is used, which limits a
+// file to 4 GB; AppendFrame() fails once a frame would not fit.
+//
+
+#ifndef ABHI_MJPEG_AVI_WRITER_H
+#define ABHI_MJPEG_AVI_WRITER_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class MjpegAviWriter
+{
+public:
+
+	MjpegAviWriter() : m_file(NULL), m_width(0), m_height(0), m_frameRate(0.0f), m_moviStart(0), m_maxFrameSize(0)
+	{
+	}
+
+	~MjpegAviWriter()
+	{
+		Close();
+	}
+
+	// Creates the file and writes placeholder headers. Returns -1 on error.
+	int Open(const std::string & path, uint32_t width, uint32_t height, float frameRate)
+	{
+		Close();
+
+		m_file = fopen(path.c_str(), "wb");
+		if (m_file == NULL)
+		{
+			return -1;
+		}
+
+		m_width = width;
+		m_height = height;
+		m_frameRate = frameRate > 0.0f ? frameRate : 15.0f;
+		m_index.clear();
+		m_maxFrameSize = 0;
+
+		WriteHeaders();
+
+		// 'movi' list; its size is patched in Close()
+		WriteFourCC("LIST");
+		WriteUint32(0);
+		m_moviStart = ftell(m_file);
+		WriteFourCC("movi");
+
+		return ferror(m_file) ? -1 : 0;
+	}
+
+	bool IsOpen() const
+	{
+		return m_file != NULL;
+	}
+
+	// Appends one JPEG-encoded frame. Returns -1 on error.
+	int AppendFrame(const void* jpeg, uint32_t size)
+	{
+		if (m_file == NULL)
+		{
+			return -1;
+		}
+
+		// Chunk, padding and index entry must stay within the 4 GB of RIFF
+		const uint64_t position = static_cast<uint64_t>(ftell(m_file));
+		const uint64_t indexSize = (m_index.size() + 1) * 16;
+		if (position + 8 + size + 1 + 8 + indexSize > 0xFFFFFFFFull)
+		{
+			return -1;
+		}
+
+		IndexEntry entry;
+		entry.offset = static_cast<uint32_t>(position - m_moviStart);
+		entry.size = size;
+		m_index.push_back(entry);
+
+		WriteFourCC("00dc");
+		WriteUint32(size);
+		fwrite(jpeg, 1, size, m_file);
+		if (size & 1)
+		{
+			fputc(0, m_file);
+		}
+
+		if (size > m_maxFrameSize)
+		{
+			m_maxFrameSize = size;
+		}
+
+		return ferror(m_file) ? -1 : 0;
+	}
+
+	// Writes the index, fills in the headers and closes the file.
+	int Close()
+	{
+		if (m_file == NULL)
+		{
+			return 0;
+		}
+
+		const uint32_t moviEnd = static_cast<uint32_t>(ftell(m_file));
+
+		WriteFourCC("idx1");
+		WriteUint32(static_cast<uint32_t>(m_index.size() * 16));
+		for (size_t i = 0; i < m_index.size(); i++)
+		{
+			WriteFourCC("00dc");
+			WriteUint32(0x10);		// AVIIF_KEYFRAME
+			WriteUint32(m_index[i].offset);
+			WriteUint32(m_index[i].size);
+		}
+
+		const uint32_t fileEnd = static_cast<uint32_t>(ftell(m_file));
+
+		// RIFF size, then the headers with the real frame count and sizes
+		fseek(m_file, 4, SEEK_SET);
+		WriteUint32(fileEnd - 8);
+
+		fseek(m_file, 12, SEEK_SET);
+		WriteHeaders();
+
+		fseek(m_file, static_cast<long>(m_moviStart) - 4, SEEK_SET);
+		WriteUint32(moviEnd - static_cast<uint32_t>(m_moviStart));
+
+		int result = ferror(m_file) ? -1 : 0;
+
+		if (fclose(m_file) != 0)
+		{
+			result = -1;
+		}
+		m_file = NULL;
+
+		return result;
+	}
+
+	size_t GetNumFrames() const { return m_index.size(); }
+
+private:
+
+	struct IndexEntry
+	{
+		uint32_t offset;			// from the 'movi' fourcc
+		uint32_t size;
+	};
+
+	void WriteFourCC(const char* fourCC)
+	{
+		fwrite(fourCC, 1, 4, m_file);
+	}
+
+	void WriteUint32(uint32_t value)
+	{
+		const uint8_t bytes[4] = { static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8),
+			static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24) };
+		fwrite(bytes, 1, 4, m_file);
+	}
+
+	void WriteUint16(uint16_t value)
+	{
+		const uint8_t bytes[2] = { static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8) };
+		fwrite(bytes, 1, 2, m_file);
+	}
+
+	// Writes the RIFF header and 'hdrl' list at the start of the file; the
+	// layout has a fixed size, so Close() can rewrite it in place
+	void WriteHeaders()
+	{
+		const uint32_t numFrames = static_cast<uint32_t>(m_index.size());
+		const uint32_t microSecPerFrame = static_cast<uint32_t>(1000000.0f / m_frameRate + 0.5f);
+		const uint32_t rateScale = 1000;
+		const uint32_t rate = static_cast<uint32_t>(m_frameRate * rateScale + 0.5f);
+		const uint32_t bufferSize = m_maxFrameSize + 8;
+
+		if (ftell(m_file) == 0)
+		{
+			WriteFourCC("RIFF");
+			WriteUint32(0);
+			WriteFourCC("AVI ");
+		}
+
+		WriteFourCC("LIST");
+		WriteUint32(4 + 8 + 56 + 8 + 4 + 8 + 56 + 8 + 40);
+		WriteFourCC("hdrl");
+
+		// Main AVI header
+		WriteFourCC("avih");
+		WriteUint32(56);
+		WriteUint32(microSecPerFrame);
+		WriteUint32(static_cast<uint32_t>(bufferSize * m_frameRate));	// max bytes per second
+		WriteUint32(0);				// padding granularity
+		WriteUint32(0x10);			// AVIF_HASINDEX
+		WriteUint32(numFrames);
+		WriteUint32(0);				// initial frames
+		WriteUint32(1);				// streams
+		WriteUint32(bufferSize);
+		WriteUint32(m_width);
+		WriteUint32(m_height);
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			WriteUint32(0);
+		}
+
+		WriteFourCC("LIST");
+		WriteUint32(4 + 8 + 56 + 8 + 40);
+		WriteFourCC("strl");
+
+		// Stream header
+		WriteFourCC("strh");
+		WriteUint32(56);
+		WriteFourCC("vids");
+		WriteFourCC("MJPG");
+		WriteUint32(0);				// flags
+		WriteUint16(0);				// priority
+		WriteUint16(0);				// language
+		WriteUint32(0);				// initial frames
+		WriteUint32(rateScale);
+		WriteUint32(rate);
+		WriteUint32(0);				// start
+		WriteUint32(numFrames);		// length
+		WriteUint32(bufferSize);
+		WriteUint32(0xFFFFFFFF);	// quality: default
+		WriteUint32(0);				// sample size
+		WriteUint16(0);				// frame rectangle
+		WriteUint16(0);
+		WriteUint16(static_cast<uint16_t>(m_width));
+		WriteUint16(static_cast<uint16_t>(m_height));
+
+		// Stream format (BITMAPINFOHEADER)
+		WriteFourCC("strf");
+		WriteUint32(40);
+		WriteUint32(40);
+		WriteUint32(m_width);
+		WriteUint32(m_height);
+		WriteUint16(1);				// planes
+		WriteUint16(24);			// bits per pixel
+		WriteFourCC("MJPG");
+		WriteUint32(m_width * m_height * 3);
+		WriteUint32(0);
+		WriteUint32(0);
+		WriteUint32(0);
+		WriteUint32(0);
+	}
+
+	FILE* m_file;
+	uint32_t m_width;
+	uint32_t m_height;
+	float m_frameRate;
+	long m_moviStart;
+	uint32_t m_maxFrameSize;
+	std::vector<IndexEntry> m_index;
+};
+
+#endif // ABHI_MJPEG_AVI_WRITER_H
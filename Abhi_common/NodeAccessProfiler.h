@@ -0,0 +1,385 @@
+//
+// NodeAccessProfiler.h
+//
+// Instrumentation for nodemap access. Every get, set and execute made through
+// ProfiledNodeMap (or timed with a NodeAccessTimer) is recorded per feature
+// name and per operation: number of accesses, total time and worst single
+// access. Calling PrintReport() just before DeInit() lists the features sorted
+// by total time, so the expensive configuration steps stand out.
+//
+// The profiler only measures; it does not change how nodes are accessed. All
+// timings include node lookup, the availability/access checks and the
+// register round trip itself.
+//
+
+#ifndef ABHI_NODE_ACCESS_PROFILER_H
+#define ABHI_NODE_ACCESS_PROFILER_H
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Kind of access being recorded
+enum nodeAccessType
+{
+	NODE_GET,
+	NODE_SET,
+	NODE_EXECUTE
+};
+
+inline const char* NodeAccessTypeName(nodeAccessType type)
+{
+	switch (type)
+	{
+	case NODE_GET:
+		return "get";
+	case NODE_SET:
+		return "set";
+	default:
+		return "execute";
+	}
+}
+
+// This class accumulates access statistics. It is safe to record from several
+// threads, e.g. when each camera is configured on its own thread.
+class NodeAccessProfiler
+{
+public:
+
+	NodeAccessProfiler(const std::string & label = "") : m_label(label) {}
+	~NodeAccessProfiler() {}
+
+	// Adds one access of the given feature that took the given time
+	void Record(const std::string & featureName, nodeAccessType type, double microseconds)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		AccessStats & stats = m_stats[std::make_pair(featureName, type)];
+		stats.count++;
+		stats.totalUs += microseconds;
+		if (microseconds > stats.maxUs)
+		{
+			stats.maxUs = microseconds;
+		}
+	}
+
+	// Forgets all recorded accesses
+	void Reset()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.clear();
+	}
+
+	// Prints one line per feature and operation, most expensive first
+	void PrintReport(std::ostream & out = std::cout) const
+	{
+		std::vector<ReportRow> rows;
+		double grandTotalUs = 0.0;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			std::map<StatsKey, AccessStats>::const_iterator it;
+			for (it = m_stats.begin(); it != m_stats.end(); ++it)
+			{
+				ReportRow row;
+				row.featureName = it->first.first;
+				row.type = it->first.second;
+				row.stats = it->second;
+				rows.push_back(row);
+
+				grandTotalUs += it->second.totalUs;
+			}
+		}
+
+		std::sort(rows.begin(), rows.end(), CompareTotalTime);
+
+		out << std::endl << "*** NODE ACCESS PROFILE";
+		if (m_label != "")
+		{
+			out << " (" << m_label << ")";
+		}
+		out << " ***" << std::endl << std::endl;
+
+		if (rows.empty())
+		{
+			out << "No node accesses recorded." << std::endl << std::endl;
+			return;
+		}
+
+		out << std::left << std::setw(32) << "Feature" << std::setw(9) << "Op"
+			<< std::right << std::setw(8) << "Count" << std::setw(14) << "Total (ms)"
+			<< std::setw(12) << "Mean (us)" << std::setw(12) << "Max (us)"
+			<< std::setw(8) << "Share" << std::endl;
+
+		std::ios::fmtflags flags = out.flags();
+		out << std::fixed;
+
+		for (size_t i = 0; i < rows.size(); i++)
+		{
+			const AccessStats & stats = rows[i].stats;
+
+			out << std::left << std::setw(32) << rows[i].featureName
+				<< std::setw(9) << NodeAccessTypeName(rows[i].type)
+				<< std::right << std::setw(8) << stats.count
+				<< std::setw(14) << std::setprecision(3) << stats.totalUs / 1000.0
+				<< std::setw(12) << std::setprecision(1) << stats.totalUs / stats.count
+				<< std::setw(12) << std::setprecision(1) << stats.maxUs
+				<< std::setw(7) << std::setprecision(1) << (100.0 * stats.totalUs / grandTotalUs) << "%"
+				<< std::endl;
+		}
+
+		out << std::endl << "Total time in node access: " << std::setprecision(3)
+			<< grandTotalUs / 1000.0 << " ms" << std::endl << std::endl;
+
+		out.flags(flags);
+	}
+
+private:
+
+	struct AccessStats
+	{
+		AccessStats() : count(0), totalUs(0.0), maxUs(0.0) {}
+
+		unsigned int count;
+		double totalUs;
+		double maxUs;
+	};
+
+	struct ReportRow
+	{
+		std::string featureName;
+		nodeAccessType type;
+		AccessStats stats;
+	};
+
+	typedef std::pair<std::string, nodeAccessType> StatsKey;
+
+	static bool CompareTotalTime(const ReportRow & a, const ReportRow & b)
+	{
+		return a.stats.totalUs > b.stats.totalUs;
+	}
+
+	std::string m_label;
+	std::map<StatsKey, AccessStats> m_stats;
+	mutable std::mutex m_mutex;
+};
+
+// This class times the scope it lives in and records it as one access. Use it
+// to profile node access that does not go through ProfiledNodeMap, e.g. loops
+// over cached node pointers.
+class NodeAccessTimer
+{
+public:
+
+	NodeAccessTimer(NodeAccessProfiler & profiler, const std::string & featureName, nodeAccessType type)
+		: m_profiler(profiler), m_featureName(featureName), m_type(type),
+		m_start(std::chrono::steady_clock::now())
+	{
+	}
+
+	~NodeAccessTimer()
+	{
+		std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - m_start;
+		m_profiler.Record(m_featureName, m_type, elapsed.count());
+	}
+
+private:
+
+	NodeAccessProfiler & m_profiler;
+	std::string m_featureName;
+	nodeAccessType m_type;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+// This class wraps a nodemap so that typical configuration steps are profiled
+// without changing their structure. Each method performs the usual
+// availability and access checks and returns false when the node cannot be
+// used, leaving the caller to decide whether that is fatal. Spinnaker
+// exceptions are passed through to the caller.
+class ProfiledNodeMap
+{
+public:
+
+	ProfiledNodeMap(Spinnaker::GenApi::INodeMap & nodeMap, NodeAccessProfiler & profiler)
+		: m_nodeMap(nodeMap), m_profiler(profiler)
+	{
+	}
+
+	Spinnaker::GenApi::INodeMap & GetNodeMap() { return m_nodeMap; }
+	NodeAccessProfiler & GetProfiler() { return m_profiler; }
+
+	bool SetEnumeration(const char* featureName, const char* entryName)
+	{
+		using namespace Spinnaker::GenApi;
+
+		NodeAccessTimer timer(m_profiler, featureName, NODE_SET);
+
+		CEnumerationPtr ptrEnumeration = m_nodeMap.GetNode(featureName);
+		if (!IsAvailable(ptrEnumeration) || !IsWritable(ptrEnumeration))
+		{
+			return false;
+		}
+
+		CEnumEntryPtr ptrEntry = ptrEnumeration->GetEntryByName(entryName);
+		if (!IsAvailable(ptrEntry) || !IsReadable(ptrEntry))
+		{
+			return false;
+		}
+
+		ptrEnumeration->SetIntValue(ptrEntry->GetValue());
+
+		return true;
+	}
+
+	bool GetEnumeration(const char* featureName, Spinnaker::GenICam::gcstring & entryName)
+	{
+		using namespace Spinnaker::GenApi;
+
+		NodeAccessTimer timer(m_profiler, featureName, NODE_GET);
+
+		CEnumerationPtr ptrEnumeration = m_nodeMap.GetNode(featureName);
+		if (!IsAvailable(ptrEnumeration) || !IsReadable(ptrEnumeration))
+		{
+			return false;
+		}
+
+		entryName = ptrEnumeration->GetCurrentEntry()->GetSymbolic();
+
+		return true;
+	}
+
+	bool SetInteger(const char* featureName, int64_t value)
+	{
+		using namespace Spinnaker::GenApi;
+
+		NodeAccessTimer timer(m_profiler, featureName, NODE_SET);
+
+		CIntegerPtr ptrInteger = m_nodeMap.GetNode(featureName);
+		if (!IsAvailable(ptrInteger) || !IsWritable(ptrInteger))
+		{
+			return false;
+		}
+
+		ptrInteger->SetValue(value);
+
+		return true;
+	}
+
+	bool GetInteger(const char* featureName, int64_t & value)
+	{
+		using namespace Spinnaker::GenApi;
+
+		NodeAccessTimer timer(m_profiler, featureName, NODE_GET);
+
+		CIntegerPtr ptrInteger = m_nodeMap.GetNode(featureName);
+		if (!IsAvailable(ptrInteger) || !IsReadable(ptrInteger))
+		{
+			return false;
+		}
+
+		value = ptrInteger->GetValue();
+
+		return true;
+	}
+
+	bool SetFloat(const char* featureName, double value)
+	{
+		using namespace Spinnaker::GenApi;
+
+		NodeAccessTimer timer(m_profiler, featureName, NODE_SET);
+
+		CFloatPtr ptrFloat = m_nodeMap.GetNode(featureName);
+		if (!IsAvailable(ptrFloat) || !IsWritable(ptrFloat))
+		{
+			return false;
+		}
+
+		ptrFloat->SetValue(value);
+
+		return true;
+	}
+
+	bool GetFloat(const char* featureName, double & value)
+	{
+		using namespace Spinnaker::GenApi;
+
+		NodeAccessTimer timer(m_profiler, featureName, NODE_GET);
+
+		CFloatPtr ptrFloat = m_nodeMap.GetNode(featureName);
+		if (!IsAvailable(ptrFloat) || !IsReadable(ptrFloat))
+		{
+			return false;
+		}
+
+		value = ptrFloat->GetValue();
+
+		return true;
+	}
+
+	bool SetBoolean(const char* featureName, bool value)
+	{
+		using namespace Spinnaker::GenApi;
+
+		NodeAccessTimer timer(m_profiler, featureName, NODE_SET);
+
+		CBooleanPtr ptrBoolean = m_nodeMap.GetNode(featureName);
+		if (!IsAvailable(ptrBoolean) || !IsWritable(ptrBoolean))
+		{
+			return false;
+		}
+
+		ptrBoolean->SetValue(value);
+
+		return true;
+	}
+
+	bool GetBoolean(const char* featureName, bool & value)
+	{
+		using namespace Spinnaker::GenApi;
+
+		NodeAccessTimer timer(m_profiler, featureName, NODE_GET);
+
+		CBooleanPtr ptrBoolean = m_nodeMap.GetNode(featureName);
+		if (!IsAvailable(ptrBoolean) || !IsReadable(ptrBoolean))
+		{
+			return false;
+		}
+
+		value = ptrBoolean->GetValue();
+
+		return true;
+	}
+
+	bool Execute(const char* featureName)
+	{
+		using namespace Spinnaker::GenApi;
+
+		NodeAccessTimer timer(m_profiler, featureName, NODE_EXECUTE);
+
+		CCommandPtr ptrCommand = m_nodeMap.GetNode(featureName);
+		if (!IsAvailable(ptrCommand) || !IsWritable(ptrCommand))
+		{
+			return false;
+		}
+
+		ptrCommand->Execute();
+
+		return true;
+	}
+
+private:
+
+	Spinnaker::GenApi::INodeMap & m_nodeMap;
+	NodeAccessProfiler & m_profiler;
+};
+
+#endif // ABHI_NODE_ACCESS_PROFILER_H
@@ -0,0 +1,92 @@
+//
+// ProcessStats.h
+//
+// Reads resource usage of the running process from /proc (Linux only):
+// resident memory, open file descriptors, threads and CPU time. Cheap enough
+// to sample every few seconds during long runs.
+//
+
+#ifndef ABHI_PROCESS_STATS_H
+#define ABHI_PROCESS_STATS_H
+
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+struct ProcessStats
+{
+	ProcessStats() : residentBytes(0), openFileDescriptors(0), numThreads(0), cpuMs(0.0) {}
+
+	unsigned long long residentBytes;
+	unsigned int openFileDescriptors;
+	unsigned int numThreads;
+	double cpuMs;			// user plus system
+};
+
+// This helper returns the resident set size from /proc/self/statm, or 0.
+inline unsigned long long ReadResidentBytes()
+{
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (file == NULL)
+	{
+		return 0;
+	}
+
+	unsigned long long sizePages = 0;
+	unsigned long long residentPages = 0;
+	if (fscanf(file, "%llu %llu", &sizePages, &residentPages) != 2)
+	{
+		residentPages = 0;
+	}
+	fclose(file);
+
+	return residentPages * static_cast<unsigned long long>(sysconf(_SC_PAGESIZE));
+}
+
+// This helper counts the entries of a /proc directory, or returns 0.
+inline unsigned int CountProcEntries(const char* path)
+{
+	DIR* dir = opendir(path);
+	if (dir == NULL)
+	{
+		return 0;
+	}
+
+	unsigned int count = 0;
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (entry->d_name[0] != '.')
+		{
+			count++;
+		}
+	}
+	closedir(dir);
+
+	return count;
+}
+
+// This function samples all statistics. The descriptor used to list
+// /proc/self/fd is itself counted and subtracted again.
+inline ProcessStats SampleProcessStats()
+{
+	ProcessStats stats;
+
+	stats.residentBytes = ReadResidentBytes();
+
+	unsigned int numFds = CountProcEntries("/proc/self/fd");
+	stats.openFileDescriptors = numFds > 0 ? numFds - 1 : 0;
+
+	stats.numThreads = CountProcEntries("/proc/self/task");
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	stats.cpuMs = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+		(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+
+	return stats;
+}
+
+#endif // ABHI_PROCESS_STATS_H
@@ -0,0 +1,337 @@
+//
+// SensorModes.h
+//
+// Switches a camera between named sensor modes: on-sensor binning and
+// decimation plus the matching Width/Height/Offset. The reduced image then
+// comes off the sensor instead of being resized on the host.
+//
+// Only nodes whose value actually changes are written. Acquisition is stopped
+// and restarted only when one of those nodes is locked while streaming;
+// offsets alone are usually writable during acquisition and do not cause a
+// restart.
+//
+
+#ifndef ABHI_SENSOR_MODES_H
+#define ABHI_SENSOR_MODES_H
+
+#include "Spinnaker.h"
+#include "SpinGenApi/SpinnakerGenApi.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// Geometry of one mode. A width or height of 0 selects the maximum available
+// after binning/decimation; an offset of -1 centres the region.
+struct SensorMode
+{
+	SensorMode(const std::string & modeName, int64_t binning = 1, int64_t decimation = 1,
+		int64_t modeWidth = 0, int64_t modeHeight = 0)
+		: name(modeName), binningHorizontal(binning), binningVertical(binning),
+		decimationHorizontal(decimation), decimationVertical(decimation),
+		width(modeWidth), height(modeHeight), offsetX(-1), offsetY(-1)
+	{
+	}
+
+	std::string name;
+	int64_t binningHorizontal;
+	int64_t binningVertical;
+	int64_t decimationHorizontal;
+	int64_t decimationVertical;
+	int64_t width;
+	int64_t height;
+	int64_t offsetX;
+	int64_t offsetY;
+};
+
+// Outcome of a mode switch
+struct SensorModeReport
+{
+	SensorModeReport() : width(0), height(0), nodesWritten(0), restarted(false), switchMs(0.0), resultingFrameRate(0.0) {}
+
+	int64_t width;
+	int64_t height;
+	unsigned int nodesWritten;
+	bool restarted;
+	double switchMs;
+	double resultingFrameRate;
+};
+
+// Full sensor resolution, no binning or decimation
+inline SensorMode FullQualityMode()
+{
+	return SensorMode("FullQuality", 1, 1);
+}
+
+// Binned by the given factor in both directions
+inline SensorMode HighSpeedBinnedMode(int64_t factor = 2)
+{
+	return SensorMode("HighSpeedBinned", factor, 1);
+}
+
+// Decimated by the given factor in both directions, for sensors without binning
+inline SensorMode HighSpeedDecimatedMode(int64_t factor = 2)
+{
+	return SensorMode("HighSpeedDecimated", 1, factor);
+}
+
+// This helper returns the current value of an integer node, or the given
+// default when the node does not exist.
+inline int64_t GetIntegerOrDefault(Spinnaker::GenApi::INodeMap & nodeMap, const char* featureName, int64_t defaultValue)
+{
+	using namespace Spinnaker::GenApi;
+
+	CIntegerPtr ptrInteger = nodeMap.GetNode(featureName);
+	if (!IsAvailable(ptrInteger) || !IsReadable(ptrInteger))
+	{
+		return defaultValue;
+	}
+
+	return ptrInteger->GetValue();
+}
+
+// This helper clamps a value into the node's range and aligns it down to the
+// node's increment.
+inline int64_t AlignToNode(Spinnaker::GenApi::CIntegerPtr ptrInteger, int64_t value)
+{
+	const int64_t minimum = ptrInteger->GetMin();
+	const int64_t maximum = ptrInteger->GetMax();
+	const int64_t increment = ptrInteger->GetInc() > 0 ? ptrInteger->GetInc() : 1;
+
+	if (value > maximum)
+	{
+		value = maximum;
+	}
+	if (value < minimum)
+	{
+		value = minimum;
+	}
+
+	return value - (value - minimum) % increment;
+}
+
+// This helper writes an integer node if its value differs. Returns -1 if the
+// node is needed but missing or locked, 0 otherwise.
+inline int WriteIntegerIfChanged(Spinnaker::GenApi::INodeMap & nodeMap, const char* featureName, int64_t value,
+	bool alignValue, SensorModeReport & report)
+{
+	using namespace Spinnaker::GenApi;
+
+	CIntegerPtr ptrInteger = nodeMap.GetNode(featureName);
+	if (!IsAvailable(ptrInteger) || !IsReadable(ptrInteger))
+	{
+		std::cout << "Unable to retrieve " << featureName << ". Aborting..." << std::endl << std::endl;
+		return -1;
+	}
+
+	if (alignValue)
+	{
+		value = AlignToNode(ptrInteger, value);
+	}
+
+	if (ptrInteger->GetValue() == value)
+	{
+		return 0;
+	}
+
+	if (!IsWritable(ptrInteger))
+	{
+		std::cout << "Unable to set " << featureName << " to " << value << ". Aborting..." << std::endl << std::endl;
+		return -1;
+	}
+
+	ptrInteger->SetValue(value);
+	report.nodesWritten++;
+
+	return 0;
+}
+
+// This function reports whether the mode changes binning, decimation or size
+// compared to the current camera settings.
+inline bool SensorModeChangesGeometry(Spinnaker::GenApi::INodeMap & nodeMap, const SensorMode & mode)
+{
+	if (GetIntegerOrDefault(nodeMap, "BinningHorizontal", 1) != mode.binningHorizontal ||
+		GetIntegerOrDefault(nodeMap, "BinningVertical", 1) != mode.binningVertical ||
+		GetIntegerOrDefault(nodeMap, "DecimationHorizontal", 1) != mode.decimationHorizontal ||
+		GetIntegerOrDefault(nodeMap, "DecimationVertical", 1) != mode.decimationVertical)
+	{
+		return true;
+	}
+
+	int64_t widthToSet = mode.width > 0 ? mode.width : GetIntegerOrDefault(nodeMap, "WidthMax", 0);
+	int64_t heightToSet = mode.height > 0 ? mode.height : GetIntegerOrDefault(nodeMap, "HeightMax", 0);
+
+	return GetIntegerOrDefault(nodeMap, "Width", 0) != widthToSet ||
+		GetIntegerOrDefault(nodeMap, "Height", 0) != heightToSet;
+}
+
+// This function reports whether any geometry node of the mode would have to
+// change while being locked by the running acquisition.
+inline bool SensorModeNeedsRestart(Spinnaker::GenApi::INodeMap & nodeMap, const SensorMode & mode)
+{
+	using namespace Spinnaker::GenApi;
+
+	const char* factorNodes[] = { "BinningHorizontal", "BinningVertical", "DecimationHorizontal", "DecimationVertical" };
+	const int64_t factors[] = { mode.binningHorizontal, mode.binningVertical, mode.decimationHorizontal, mode.decimationVertical };
+
+	bool factorsChange = false;
+
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		CIntegerPtr ptrFactor = nodeMap.GetNode(factorNodes[i]);
+		if (!IsAvailable(ptrFactor) || !IsReadable(ptrFactor) || ptrFactor->GetValue() == factors[i])
+		{
+			continue;
+		}
+
+		if (!IsWritable(ptrFactor))
+		{
+			return true;
+		}
+
+		factorsChange = true;
+	}
+
+	// Changing factors nearly always changes the size as well; otherwise the
+	// size only changes if the mode asks for something other than the current.
+	const char* sizeNodes[] = { "Width", "Height" };
+	const char* sizeMaxNodes[] = { "WidthMax", "HeightMax" };
+	const int64_t sizes[] = { mode.width, mode.height };
+
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		CIntegerPtr ptrSize = nodeMap.GetNode(sizeNodes[i]);
+		if (!IsAvailable(ptrSize) || IsWritable(ptrSize))
+		{
+			continue;
+		}
+
+		int64_t sizeToSet = sizes[i] > 0 ? sizes[i] : GetIntegerOrDefault(nodeMap, sizeMaxNodes[i], 0);
+
+		if (factorsChange || AlignToNode(ptrSize, sizeToSet) != ptrSize->GetValue())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// This function switches the camera to the given mode. It may be called while
+// the camera is streaming; acquisition is restarted only when required.
+inline int ApplySensorMode(Spinnaker::CameraPtr pCam, const SensorMode & mode, SensorModeReport & report)
+{
+	using namespace Spinnaker::GenApi;
+
+	int result = 0;
+	report = SensorModeReport();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	try
+	{
+		INodeMap & nodeMap = pCam->GetNodeMap();
+
+		// Stop only if a locked node has to change
+		bool wasStreaming = pCam->IsStreaming();
+
+		if (wasStreaming && SensorModeNeedsRestart(nodeMap, mode))
+		{
+			pCam->EndAcquisition();
+			report.restarted = true;
+		}
+
+		// Move the region to the origin so any size becomes legal
+		if (SensorModeChangesGeometry(nodeMap, mode))
+		{
+			result = result | WriteIntegerIfChanged(nodeMap, "OffsetX", 0, false, report);
+			result = result | WriteIntegerIfChanged(nodeMap, "OffsetY", 0, false, report);
+		}
+
+		// Factors going down first, then factors going up; some sensors do
+		// not allow binning and decimation to be combined.
+		const char* factorNodes[] = { "BinningHorizontal", "BinningVertical", "DecimationHorizontal", "DecimationVertical" };
+		const int64_t factors[] = { mode.binningHorizontal, mode.binningVertical, mode.decimationHorizontal, mode.decimationVertical };
+
+		for (unsigned int pass = 0; pass < 2 && result == 0; pass++)
+		{
+			for (unsigned int i = 0; i < 4 && result == 0; i++)
+			{
+				// A factor of 1 is the same as not having the feature
+				CIntegerPtr ptrFactor = nodeMap.GetNode(factorNodes[i]);
+				if (factors[i] == 1 && (!IsAvailable(ptrFactor) || !IsReadable(ptrFactor)))
+				{
+					continue;
+				}
+
+				int64_t current = GetIntegerOrDefault(nodeMap, factorNodes[i], 1);
+				bool decreasing = factors[i] < current;
+
+				if ((pass == 0) == decreasing)
+				{
+					result = result | WriteIntegerIfChanged(nodeMap, factorNodes[i], factors[i], false, report);
+				}
+			}
+		}
+
+		// Size; the maximum reflects the factors just written
+		if (result == 0)
+		{
+			int64_t widthToSet = mode.width > 0 ? mode.width : GetIntegerOrDefault(nodeMap, "WidthMax", 0);
+			int64_t heightToSet = mode.height > 0 ? mode.height : GetIntegerOrDefault(nodeMap, "HeightMax", 0);
+
+			result = result | WriteIntegerIfChanged(nodeMap, "Width", widthToSet, true, report);
+			result = result | WriteIntegerIfChanged(nodeMap, "Height", heightToSet, true, report);
+		}
+
+		// Offsets, centred unless given
+		if (result == 0)
+		{
+			int64_t width = GetIntegerOrDefault(nodeMap, "Width", 0);
+			int64_t height = GetIntegerOrDefault(nodeMap, "Height", 0);
+
+			int64_t offsetX = mode.offsetX >= 0 ? mode.offsetX : (GetIntegerOrDefault(nodeMap, "WidthMax", width) - width) / 2;
+			int64_t offsetY = mode.offsetY >= 0 ? mode.offsetY : (GetIntegerOrDefault(nodeMap, "HeightMax", height) - height) / 2;
+
+			result = result | WriteIntegerIfChanged(nodeMap, "OffsetX", offsetX, true, report);
+			result = result | WriteIntegerIfChanged(nodeMap, "OffsetY", offsetY, true, report);
+
+			report.width = width;
+			report.height = height;
+		}
+
+		if (report.restarted)
+		{
+			pCam->BeginAcquisition();
+		}
+
+		CFloatPtr ptrResultingFrameRate = nodeMap.GetNode("AcquisitionResultingFrameRate");
+		if (IsAvailable(ptrResultingFrameRate) && IsReadable(ptrResultingFrameRate))
+		{
+			report.resultingFrameRate = ptrResultingFrameRate->GetValue();
+		}
+	}
+	catch (Spinnaker::Exception &e)
+	{
+		std::cout << "Error: " << e.what() << std::endl;
+		result = -1;
+
+		// Leave the camera streaming if we stopped it
+		try
+		{
+			if (report.restarted && !pCam->IsStreaming())
+			{
+				pCam->BeginAcquisition();
+			}
+		}
+		catch (Spinnaker::Exception &)
+		{
+		}
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	report.switchMs = elapsed.count();
+
+	return result;
+}
+
+#endif // ABHI_SENSOR_MODES_H
@@ -0,0 +1,173 @@
+//
+// StripeWorkerPool.h
+//
+// A fixed set of worker threads for splitting one frame into stripes (or
+// tiles) and processing them in parallel. Threads are created once and reused
+// for every frame; Run() hands out stripe indices until all are done and
+// returns when the last one has finished. The calling thread works on stripes
+// as well, so a pool of one thread runs everything inline.
+//
+
+#ifndef ABHI_STRIPE_WORKER_POOL_H
+#define ABHI_STRIPE_WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class StripeWorkerPool
+{
+public:
+
+	typedef std::function<void(unsigned int)> StripeTask;
+
+	// numThreads counts the calling thread; 0 selects one per hardware thread
+	StripeWorkerPool(unsigned int numThreads = 0)
+		: m_task(NULL), m_numStripes(0), m_nextStripe(0), m_stripesDone(0), m_generation(0), m_stopping(false)
+	{
+		if (numThreads == 0)
+		{
+			numThreads = std::thread::hardware_concurrency();
+		}
+		if (numThreads == 0)
+		{
+			numThreads = 1;
+		}
+
+		for (unsigned int i = 1; i < numThreads; i++)
+		{
+			m_workers.push_back(std::thread(&StripeWorkerPool::WorkerLoop, this));
+		}
+	}
+
+	~StripeWorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+
+		m_workAvailable.notify_all();
+
+		for (size_t i = 0; i < m_workers.size(); i++)
+		{
+			m_workers[i].join();
+		}
+	}
+
+	unsigned int GetNumThreads() const
+	{
+		return static_cast<unsigned int>(m_workers.size()) + 1;
+	}
+
+	// Runs task(i) for every i in [0, numStripes) and waits for completion.
+	// Only one Run() may be active at a time.
+	void Run(unsigned int numStripes, const StripeTask & task)
+	{
+		if (numStripes == 0)
+		{
+			return;
+		}
+
+		if (m_workers.empty() || numStripes == 1)
+		{
+			for (unsigned int i = 0; i < numStripes; i++)
+			{
+				task(i);
+			}
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_task = &task;
+			m_numStripes = numStripes;
+			m_nextStripe = 0;
+			m_stripesDone = 0;
+			m_generation++;
+		}
+
+		m_workAvailable.notify_all();
+
+		ProcessStripes();
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (m_stripesDone < m_numStripes)
+		{
+			m_workDone.wait(lock);
+		}
+		m_task = NULL;
+	}
+
+private:
+
+	void WorkerLoop()
+	{
+		unsigned long long lastGeneration = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				while (!m_stopping && m_generation == lastGeneration)
+				{
+					m_workAvailable.wait(lock);
+				}
+
+				if (m_stopping)
+				{
+					return;
+				}
+
+				lastGeneration = m_generation;
+			}
+
+			ProcessStripes();
+		}
+	}
+
+	// Claims stripes until none are left
+	void ProcessStripes()
+	{
+		unsigned int numDone = 0;
+
+		while (true)
+		{
+			unsigned int stripe = m_nextStripe.fetch_add(1);
+			if (stripe >= m_numStripes)
+			{
+				break;
+			}
+
+			(*m_task)(stripe);
+			numDone++;
+		}
+
+		if (numDone > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stripesDone += numDone;
+			if (m_stripesDone == m_numStripes)
+			{
+				m_workDone.notify_one();
+			}
+		}
+	}
+
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_workDone;
+
+	const StripeTask* m_task;
+	unsigned int m_numStripes;
+	std::atomic<unsigned int> m_nextStripe;
+	unsigned int m_stripesDone;
+	unsigned long long m_generation;
+	bool m_stopping;
+};
+
+#endif // ABHI_STRIPE_WORKER_POOL_H
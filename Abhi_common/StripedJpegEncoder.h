@@ -0,0 +1,333 @@
+//
+// StripedJpegEncoder.h
+//
+// Encodes one frame to JPEG on several threads. The frame is cut into
+// horizontal stripes whose height is a whole number of MCU rows, every
+// stripe is encoded on its own with libjpeg on a StripeWorkerPool, and the
+// stripes are stitched into one baseline JPEG:
+//
+//	headers of stripe 0, with a restart interval of one stripe (DRI) and
+//	the full frame height patched into SOF
+//	entropy-coded data of stripe 0
+//	RST0, entropy-coded data of stripe 1
+//	RST1, entropy-coded data of stripe 2
+//	...
+//	EOI
+//
+// A restart marker resets the DC predictors and byte-aligns the data,
+// which is exactly the state a fresh encoder starts each stripe in, so the
+// result decodes to the same pixels as a single-threaded encode with the
+// same quality. Standard Huffman tables are used, so all stripes share the
+// tables in the header of stripe 0.
+//
+// Gray frames are encoded as such; BGR frames use the libjpeg default of
+// YCbCr 4:2:0. Links against libjpeg (-ljpeg).
+//
+
+#ifndef ABHI_STRIPED_JPEG_ENCODER_H
+#define ABHI_STRIPED_JPEG_ENCODER_H
+
+#include <algorithm>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <jpeglib.h>
+#include "FrameWriter.h"
+#include "StripeWorkerPool.h"
+
+// libjpeg destination that appends to a std::vector
+struct JpegVectorDestination
+{
+	jpeg_destination_mgr manager;
+	std::vector<uint8_t>* buffer;
+
+	static void InitDestination(j_compress_ptr cinfo)
+	{
+		JpegVectorDestination* dest = reinterpret_cast<JpegVectorDestination*>(cinfo->dest);
+		dest->buffer->resize(std::max<size_t>(dest->buffer->capacity(), 65536));
+		dest->manager.next_output_byte = &(*dest->buffer)[0];
+		dest->manager.free_in_buffer = dest->buffer->size();
+	}
+
+	static boolean EmptyOutputBuffer(j_compress_ptr cinfo)
+	{
+		JpegVectorDestination* dest = reinterpret_cast<JpegVectorDestination*>(cinfo->dest);
+		const size_t used = dest->buffer->size();
+		dest->buffer->resize(used * 2);
+		dest->manager.next_output_byte = &(*dest->buffer)[used];
+		dest->manager.free_in_buffer = dest->buffer->size() - used;
+		return TRUE;
+	}
+
+	static void TermDestination(j_compress_ptr cinfo)
+	{
+		JpegVectorDestination* dest = reinterpret_cast<JpegVectorDestination*>(cinfo->dest);
+		dest->buffer->resize(dest->buffer->size() - dest->manager.free_in_buffer);
+	}
+};
+
+// libjpeg error handler that returns to the encoder instead of exiting
+struct JpegErrorHandler
+{
+	jpeg_error_mgr manager;
+	jmp_buf jumpBuffer;
+
+	static void ErrorExit(j_common_ptr cinfo)
+	{
+		longjmp(reinterpret_cast<JpegErrorHandler*>(cinfo->err)->jumpBuffer, 1);
+	}
+};
+
+class StripedJpegEncoder
+{
+public:
+
+	// numStripes 0 uses one stripe per pool thread
+	StripedJpegEncoder(StripeWorkerPool & pool, int quality = 75, unsigned int numStripes = 0)
+		: m_pool(pool), m_quality(quality), m_numStripes(numStripes)
+	{
+	}
+
+	~StripedJpegEncoder()
+	{
+		for (size_t i = 0; i < m_stripes.size(); i++)
+		{
+			jpeg_destroy_compress(&m_stripes[i]->cinfo);
+			delete m_stripes[i];
+		}
+	}
+
+	// Encodes a Mono8 or BGR8 frame. Returns -1 on error.
+	int Encode(const FrameView & frame, std::vector<uint8_t> & jpeg)
+	{
+		if (frame.channels != 1 && frame.channels != 3)
+		{
+			return -1;
+		}
+
+		// Stripes are whole MCU rows; the restart interval counts MCUs in
+		// 16 bits, which bounds the stripe size
+		const unsigned int mcuSize = frame.channels == 1 ? 8 : 16;
+		const unsigned int mcusPerRow = (frame.width + mcuSize - 1) / mcuSize;
+		const unsigned int mcuRows = (frame.height + mcuSize - 1) / mcuSize;
+		const unsigned int maxStripeMcuRows = std::max(1u, 65535 / std::max(1u, mcusPerRow));
+
+		unsigned int numStripes = m_numStripes > 0 ? m_numStripes : m_pool.GetNumThreads();
+		numStripes = std::max(numStripes, (mcuRows + maxStripeMcuRows - 1) / maxStripeMcuRows);
+		numStripes = std::max(1u, std::min(numStripes, mcuRows));
+
+		const unsigned int stripeMcuRows = (mcuRows + numStripes - 1) / numStripes;
+		numStripes = (mcuRows + stripeMcuRows - 1) / stripeMcuRows;
+
+		while (m_stripes.size() < numStripes)
+		{
+			m_stripes.push_back(CreateStripe());
+		}
+
+		const unsigned int stripeHeight = stripeMcuRows * mcuSize;
+		const unsigned int restartInterval = numStripes > 1 ? stripeMcuRows * mcusPerRow : 0;
+
+		m_pool.Run(numStripes, [&](unsigned int stripe)
+		{
+			const unsigned int top = stripe * stripeHeight;
+			const unsigned int height = std::min(stripeHeight, frame.height - top);
+
+			EncodeStripe(*m_stripes[stripe], frame, top, height, stripe == 0 ? restartInterval : 0);
+		});
+
+		for (unsigned int i = 0; i < numStripes; i++)
+		{
+			if (!m_stripes[i]->succeeded)
+			{
+				return -1;
+			}
+		}
+
+		return Stitch(numStripes, frame.height, jpeg);
+	}
+
+private:
+
+	struct Stripe
+	{
+		jpeg_compress_struct cinfo;
+		JpegErrorHandler error;
+		JpegVectorDestination destination;
+		std::vector<uint8_t> output;
+		std::vector<uint8_t> swapRow;
+		bool succeeded;
+	};
+
+	Stripe* CreateStripe()
+	{
+		Stripe* stripe = new Stripe();
+
+		stripe->cinfo.err = jpeg_std_error(&stripe->error.manager);
+		stripe->error.manager.error_exit = JpegErrorHandler::ErrorExit;
+		jpeg_create_compress(&stripe->cinfo);
+
+		stripe->destination.manager.init_destination = JpegVectorDestination::InitDestination;
+		stripe->destination.manager.empty_output_buffer = JpegVectorDestination::EmptyOutputBuffer;
+		stripe->destination.manager.term_destination = JpegVectorDestination::TermDestination;
+		stripe->destination.buffer = &stripe->output;
+		stripe->cinfo.dest = &stripe->destination.manager;
+
+		return stripe;
+	}
+
+	// Encodes rows [top, top + height) as a JPEG of their own
+	void EncodeStripe(Stripe & stripe, const FrameView & frame, unsigned int top, unsigned int height, unsigned int restartInterval)
+	{
+		jpeg_compress_struct & cinfo = stripe.cinfo;
+		stripe.succeeded = false;
+
+		if (setjmp(stripe.error.jumpBuffer))
+		{
+			jpeg_abort_compress(&cinfo);
+			return;
+		}
+
+		cinfo.image_width = frame.width;
+		cinfo.image_height = height;
+		cinfo.input_components = static_cast<int>(frame.channels);
+#ifdef JCS_EXTENSIONS
+		cinfo.in_color_space = frame.channels == 1 ? JCS_GRAYSCALE : JCS_EXT_BGR;
+#else
+		cinfo.in_color_space = frame.channels == 1 ? JCS_GRAYSCALE : JCS_RGB;
+#endif
+
+		jpeg_set_defaults(&cinfo);
+		jpeg_set_quality(&cinfo, m_quality, TRUE);
+		cinfo.optimize_coding = FALSE;
+		cinfo.restart_interval = restartInterval;
+
+		jpeg_start_compress(&cinfo, TRUE);
+
+		while (cinfo.next_scanline < cinfo.image_height)
+		{
+			const uint8_t* row = frame.data + static_cast<size_t>(top + cinfo.next_scanline) * frame.stride;
+
+#ifndef JCS_EXTENSIONS
+			// Plain libjpeg takes RGB only
+			if (frame.channels == 3)
+			{
+				stripe.swapRow.resize(static_cast<size_t>(frame.width) * 3);
+				for (unsigned int x = 0; x < frame.width; x++)
+				{
+					stripe.swapRow[3 * x] = row[3 * x + 2];
+					stripe.swapRow[3 * x + 1] = row[3 * x + 1];
+					stripe.swapRow[3 * x + 2] = row[3 * x];
+				}
+				row = &stripe.swapRow[0];
+			}
+#endif
+
+			JSAMPROW rowPointer = const_cast<JSAMPROW>(row);
+			jpeg_write_scanlines(&cinfo, &rowPointer, 1);
+		}
+
+		jpeg_finish_compress(&cinfo);
+		stripe.succeeded = true;
+	}
+
+	// This helper finds the end of the SOS header, where the entropy-coded
+	// data starts, and the SOF marker. Returns false if either is missing.
+	static bool FindScanData(const std::vector<uint8_t> & jpeg, size_t & dataStart, size_t & sofOffset)
+	{
+		size_t offset = 2;
+		sofOffset = 0;
+
+		while (offset + 4 <= jpeg.size() && jpeg[offset] == 0xFF)
+		{
+			const uint8_t marker = jpeg[offset + 1];
+			const size_t length = (static_cast<size_t>(jpeg[offset + 2]) << 8) | jpeg[offset + 3];
+
+			if (marker == 0xC0 || marker == 0xC1)
+			{
+				sofOffset = offset;
+			}
+
+			offset += 2 + length;
+
+			if (marker == 0xDA)
+			{
+				dataStart = offset;
+				return sofOffset != 0 && dataStart + 2 <= jpeg.size();
+			}
+		}
+
+		return false;
+	}
+
+	int Stitch(unsigned int numStripes, unsigned int frameHeight, std::vector<uint8_t> & jpeg)
+	{
+		size_t dataStart;
+		size_t sofOffset;
+
+		const std::vector<uint8_t> & first = m_stripes[0]->output;
+		if (!FindScanData(first, dataStart, sofOffset))
+		{
+			return -1;
+		}
+
+		// Stripe 0 keeps its headers; EOI comes at the very end
+		jpeg.assign(first.begin(), first.end() - 2);
+		jpeg[sofOffset + 5] = static_cast<uint8_t>(frameHeight >> 8);
+		jpeg[sofOffset + 6] = static_cast<uint8_t>(frameHeight);
+
+		for (unsigned int i = 1; i < numStripes; i++)
+		{
+			const std::vector<uint8_t> & stripe = m_stripes[i]->output;
+			size_t stripeSofOffset;
+
+			if (!FindScanData(stripe, dataStart, stripeSofOffset))
+			{
+				return -1;
+			}
+
+			jpeg.push_back(0xFF);
+			jpeg.push_back(static_cast<uint8_t>(0xD0 + ((i - 1) & 7)));
+			jpeg.insert(jpeg.end(), stripe.begin() + dataStart, stripe.end() - 2);
+		}
+
+		jpeg.push_back(0xFF);
+		jpeg.push_back(0xD9);
+
+		return 0;
+	}
+
+	StripeWorkerPool & m_pool;
+	int m_quality;
+	unsigned int m_numStripes;
+	std::vector<Stripe*> m_stripes;
+};
+
+// FrameWriter that saves JPEG files through a StripedJpegEncoder
+class StripedJpegWriter : public FrameWriter
+{
+public:
+
+	StripedJpegWriter(StripeWorkerPool & pool, int quality = 75, unsigned int numStripes = 0)
+		: m_encoder(pool, quality, numStripes)
+	{
+	}
+
+	int Write(const std::string & path, const FrameView & frame)
+	{
+		if (m_encoder.Encode(frame, m_buffer) != 0)
+		{
+			return -1;
+		}
+
+		return WriteFileBytes(path, m_buffer);
+	}
+
+private:
+
+	StripedJpegEncoder m_encoder;
+	std::vector<uint8_t> m_buffer;
+};
+
+#endif // ABHI_STRIPED_JPEG_ENCODER_H
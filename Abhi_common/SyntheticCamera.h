@@ -0,0 +1,229 @@
+//
+// SyntheticCamera.h
+//
+// Produces camera-like frames without hardware, for benchmarks and tests of
+// the processing path. A textured scene with a few bright spots is rendered
+// once from a fixed seed; each frame is a window into that scene that moves a
+// little every frame, so content changes but generating a frame costs little
+// more than a copy. Mono8 and BayerRG8 (RGGB) output are supported.
+//
+// The same seed, size and format always give the same frame sequence.
+//
+
+#ifndef ABHI_SYNTHETIC_CAMERA_H
+#define ABHI_SYNTHETIC_CAMERA_H
+
+#include <stdint.h>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+enum syntheticFormat
+{
+	SYNTHETIC_MONO8,
+	SYNTHETIC_BAYER_RG8
+};
+
+class SyntheticCamera
+{
+public:
+
+	// Maximum displacement of the window into the scene, in pixels
+	static const unsigned int k_motionRange = 64;
+
+	SyntheticCamera(unsigned int width, unsigned int height, syntheticFormat format, uint32_t seed = 1)
+		: m_width(width), m_height(height), m_format(format), m_seed(seed), m_frameId(0),
+		m_sceneWidth(width + k_motionRange), m_sceneHeight(height + k_motionRange),
+		m_frame(static_cast<size_t>(width) * height)
+	{
+		RenderScene();
+	}
+
+	unsigned int GetWidth() const { return m_width; }
+	unsigned int GetHeight() const { return m_height; }
+	size_t GetStride() const { return m_width; }
+	size_t GetImageSize() const { return m_frame.size(); }
+	syntheticFormat GetFormat() const { return m_format; }
+	uint64_t GetFrameId() const { return m_frameId; }
+
+	std::string GetPixelFormatName() const
+	{
+		return m_format == SYNTHETIC_MONO8 ? "Mono8" : "BayerRG8";
+	}
+
+	// Renders the next frame and returns its data; valid until the next call
+	const uint8_t* NextFrame()
+	{
+		unsigned int offsetX;
+		unsigned int offsetY;
+		GetFrameOffset(m_frameId, offsetX, offsetY);
+
+		const uint8_t* source = &m_scene[static_cast<size_t>(offsetY) * m_sceneWidth + offsetX];
+
+		for (unsigned int y = 0; y < m_height; y++)
+		{
+			memcpy(&m_frame[static_cast<size_t>(y) * m_width], source + static_cast<size_t>(y) * m_sceneWidth, m_width);
+		}
+
+		// Stamp the frame number into the first pixels so frames differ even
+		// when the window returns to an earlier position
+		for (unsigned int i = 0; i < 8 && i < m_width; i++)
+		{
+			m_frame[i] = static_cast<uint8_t>(m_frameId >> (8 * i));
+		}
+
+		m_frameId++;
+
+		return &m_frame[0];
+	}
+
+	// Restarts the sequence at frame 0
+	void Rewind()
+	{
+		m_frameId = 0;
+	}
+
+	// Renders what an ideal sensor would have seen for the given frame: no
+	// noise and, for colour, all three channels at every pixel. Output is
+	// BGR8 when colour is set and Mono8 otherwise, width * height pixels
+	// without padding. Used as the reference for quality measurements.
+	void RenderReference(uint64_t frameId, bool colour, uint8_t* out) const
+	{
+		unsigned int offsetX;
+		unsigned int offsetY;
+		GetFrameOffset(frameId, offsetX, offsetY);
+
+		for (unsigned int y = 0; y < m_height; y++)
+		{
+			for (unsigned int x = 0; x < m_width; x++)
+			{
+				float rgb[3];
+				SceneColour(x + offsetX, y + offsetY, rgb);
+
+				if (colour)
+				{
+					out[0] = ClampToByte(rgb[2]);
+					out[1] = ClampToByte(rgb[1]);
+					out[2] = ClampToByte(rgb[0]);
+					out += 3;
+				}
+				else
+				{
+					*out++ = ClampToByte(Luma(rgb));
+				}
+			}
+		}
+	}
+
+private:
+
+	// Window position of a frame: a slow Lissajous path kept on even
+	// coordinates so the Bayer phase does not change
+	void GetFrameOffset(uint64_t frameId, unsigned int & offsetX, unsigned int & offsetY) const
+	{
+		const double half = (k_motionRange - 2) / 2.0;
+		const double t = static_cast<double>(frameId);
+
+		offsetX = static_cast<unsigned int>(half + half * std::sin(t * 0.05)) & ~1u;
+		offsetY = static_cast<unsigned int>(half + half * std::sin(t * 0.03 + 1.0)) & ~1u;
+	}
+
+	// Deterministic pseudo-random numbers, independent of the C library
+	uint32_t NextRandom(uint32_t & state) const
+	{
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+
+	static uint8_t ClampToByte(float value)
+	{
+		return static_cast<uint8_t>(value < 0.0f ? 0.0f : (value > 255.0f ? 255.0f : value + 0.5f));
+	}
+
+	static float Luma(const float rgb[3])
+	{
+		return 0.299f * rgb[0] + 0.587f * rgb[1] + 0.114f * rgb[2];
+	}
+
+	// Scene colour at a point: gradients, a ring pattern and bright spots
+	void SceneColour(unsigned int x, unsigned int y, float rgb[3]) const
+	{
+		const float fx = static_cast<float>(x) / m_sceneWidth;
+		const float fy = static_cast<float>(y) / m_sceneHeight;
+		const float dx = fx - 0.5f;
+		const float dy = fy - 0.5f;
+		const float ring = 0.5f + 0.5f * std::cos(60.0f * std::sqrt(dx * dx + dy * dy));
+
+		rgb[0] = 40.0f + 120.0f * fx + 40.0f * ring;
+		rgb[1] = 40.0f + 100.0f * fy + 40.0f * ring;
+		rgb[2] = 60.0f + 80.0f * (1.0f - fx) + 40.0f * ring;
+
+		for (size_t i = 0; i + 2 < m_spots.size(); i += 3)
+		{
+			const float sx = x - m_spots[i];
+			const float sy = y - m_spots[i + 1];
+			const float sigma = m_spots[i + 2];
+			const float peak = 200.0f * std::exp(-(sx * sx + sy * sy) / (2.0f * sigma * sigma));
+
+			rgb[0] += peak;
+			rgb[1] += peak;
+			rgb[2] += peak;
+		}
+	}
+
+	void RenderScene()
+	{
+		uint32_t state = m_seed;
+
+		m_spots.clear();
+		for (unsigned int i = 0; i < 8; i++)
+		{
+			m_spots.push_back(static_cast<float>(NextRandom(state) % m_sceneWidth));
+			m_spots.push_back(static_cast<float>(NextRandom(state) % m_sceneHeight));
+			m_spots.push_back(2.0f + (NextRandom(state) % 40) / 10.0f);
+		}
+
+		m_scene.resize(static_cast<size_t>(m_sceneWidth) * m_sceneHeight);
+
+		for (unsigned int y = 0; y < m_sceneHeight; y++)
+		{
+			for (unsigned int x = 0; x < m_sceneWidth; x++)
+			{
+				float rgb[3];
+				SceneColour(x, y, rgb);
+
+				float value;
+				if (m_format == SYNTHETIC_MONO8)
+				{
+					value = Luma(rgb);
+				}
+				else
+				{
+					// RGGB: R at (even, even), B at (odd, odd), G elsewhere
+					const unsigned int channel = (y & 1) == 0 ? ((x & 1) == 0 ? 0 : 1) : ((x & 1) == 0 ? 1 : 2);
+					value = rgb[channel];
+				}
+
+				// A little sensor noise
+				value += static_cast<float>(NextRandom(state) % 9) - 4.0f;
+
+				m_scene[static_cast<size_t>(y) * m_sceneWidth + x] = ClampToByte(value);
+			}
+		}
+	}
+
+	unsigned int m_width;
+	unsigned int m_height;
+	syntheticFormat m_format;
+	uint32_t m_seed;
+	uint64_t m_frameId;
+
+	unsigned int m_sceneWidth;
+	unsigned int m_sceneHeight;
+	std::vector<float> m_spots;		// (x, y, sigma) triples
+	std::vector<uint8_t> m_scene;
+	std::vector<uint8_t> m_frame;
+};
+
+#endif // ABHI_SYNTHETIC_CAMERA_H
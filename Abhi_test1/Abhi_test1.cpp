@@ -22,6 +22,7 @@
 #include "SpinGenApi/SpinnakerGenApi.h"
 #include <iostream>
 #include <sstream> 
+#include <deque>
 #include <sys/timeb.h>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -164,7 +165,7 @@ int AcquireImages(CameraPtr pCam, INodeMap & nodeMap, INodeMap & nodeMapTLDevice
 		int start = getMilliCount();
 		
 		//for (unsigned int imageCnt = 0; imageCnt < k_numImages; imageCnt++)
-		vector<int> v_time;
+		deque<int> v_time;
 		while(key!=27 && key!='q')
 		{
 			
@@ -250,6 +251,9 @@ int AcquireImages(CameraPtr pCam, INodeMap & nodeMap, INodeMap & nodeMapTLDevice
 						int t = timeElapsed-v_time[v_time.size()-10];
 						double fps = 10000.0/t;
 						cout << fps << endl;
+
+						// Only the last 10 timestamps are needed; keep the history bounded
+						v_time.pop_front();
 					}
 					
 					//key = cv::waitKey(50);
@@ -2,6 +2,7 @@
 #include "SpinGenApi/SpinnakerGenApi.h"
 #include <iostream>
 #include <sstream> 
+#include <deque>
 #include <sys/timeb.h>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -113,7 +114,7 @@ int AcquireImages(CameraList camList)
 		cv::Mat image[2];
 
 		int start = getMilliCount();
-		vector<int> v_time;
+		deque<int> v_time;
 
 		while(key!=27 && key!='q')
 		{
@@ -175,6 +176,9 @@ int AcquireImages(CameraList camList)
 		                                        int t = timeElapsed-v_time[v_time.size()-10];
 		                                        double fps = 10000.0/t;
 		                                        cout << fps << endl;
+
+		                                        // Only the last 10 timestamps are needed; keep the history bounded
+		                                        v_time.pop_front();
 		                                }
 	
 						//key = cv::waitKey(1);